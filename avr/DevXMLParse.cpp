@@ -20,9 +20,15 @@ DXMLParser::Eval(xmlNodePtr root, const std::string &str) {
   return xpathObj;
 }
 
-DXMLParser::DXMLParser(std::string XMLFile)
+#define EDC_NAMESPACE "http://crownking/edc"
+
+DXMLParser::DXMLParser(std::string XMLFile, bool Streaming)
 {
   ParserInitialized = false;
+  xDoc = NULL;
+  xpathCtx = NULL;
+  xReader = NULL;
+  xStreaming = Streaming;
   xmlInitParser();
   xConfigFile = XMLFile;
 }
@@ -33,12 +39,33 @@ DXMLParser::~DXMLParser()
     xmlXPathFreeContext(xpathCtx);
   if (xDoc != NULL)
     xmlFreeDoc(xDoc);
+  if (xReader != NULL)
+    xmlFreeTextReader(xReader);
 
   xmlCleanupParser();
 }
 
+bool DXMLParser::RegisterNamespaces(void)
+{
+  /* Register namespaces */
+  if (xmlXPathRegisterNs(xpathCtx, (const unsigned char *)"edc", (const unsigned char *)EDC_NAMESPACE) < 0) {
+    fprintf(stderr,"Error: failed to register namespaces list \n");
+    return false;
+  }
+  return true;
+}
+
 bool DXMLParser::Initialize(void)
 {
+  if (xStreaming)
+    {
+      /* Nothing is parsed up front, the XPath context is created once the
+         sector subtree has been expanded.  */
+      xReader = xmlReaderForFile(xConfigFile.c_str(), NULL, 0);
+      ParserInitialized = (xReader != NULL);
+      return ParserInitialized;
+    }
+
   xDoc = xmlParseFile(xConfigFile.c_str());
   if (xDoc == NULL)
     return false;
@@ -49,11 +76,8 @@ bool DXMLParser::Initialize(void)
     return NULL;
   }
 
-  /* Register namespaces */
-  if (xmlXPathRegisterNs(xpathCtx, (const unsigned char *)"edc", (const unsigned char *)"http://crownking/edc") < 0) {
-    fprintf(stderr,"Error: failed to register namespaces list \n");
-    return NULL;
-  }
+  if (!RegisterNamespaces())
+    return false;
 
   ParserInitialized = true;
   return ParserInitialized;
@@ -247,10 +271,111 @@ DXMLParser::GetRegisterConfig (xmlNodePtr SectorNode, ConfigSpace &Space)
   return true;
 }
 
+bool
+DXMLParser::GetSectorNodeConfig (xmlNodePtr FusesSectorNode,
+                                 std::string SectorName,
+                                 ConfigSpace &Space, char *Error)
+{
+  uint32_t SectorAddress = 0; // FIXME assumed 0 as address, not used anywhere
+
+  const char *Str = GetAttribute(FusesSectorNode, "beginaddr");
+  uint32_t saddress = strtol(Str, NULL, 0);
+  Str = GetAttribute(FusesSectorNode, "endaddr");
+  uint32_t eaddress = strtol(Str, NULL, 0);
+  uint32_t FuseSectorWidth = eaddress - saddress;
+
+  Space.SetValues(SectorName, SectorAddress, FuseSectorWidth);
+  if (!GetRegisterConfig (FusesSectorNode, Space))
+    {
+      sprintf (Error, "Error in reading config registers.");
+      return false;
+    }
+
+  return true;
+}
+
+/* Streaming counterpart of GetSectorConfig.  The reader releases each node
+   as soon as it moved past it, only the ConfigFuseSector subtree is expanded
+   to a (partial) tree so that the DOM walkers can be used on it.  The rest
+   of the file is still scanned to diagnose non-unique sectors.  */
+
+bool
+DXMLParser::GetSectorConfigStream (std::string SectorName,
+                                   ConfigSpace &Space, char *Error)
+{
+  unsigned int nConfigFuseSector = 0;
+  int ret = xmlTextReaderRead(xReader);
+
+  while (ret == 1)
+    {
+      if (xmlTextReaderNodeType(xReader) != XML_READER_TYPE_ELEMENT
+          || xmlStrcmp(xmlTextReaderConstLocalName(xReader),
+                       (const xmlChar*)"ConfigFuseSector") != 0)
+        {
+          ret = xmlTextReaderRead(xReader);
+          continue;
+        }
+
+      xmlChar *RegionId
+        = xmlTextReaderGetAttributeNs(xReader, (const xmlChar*)"regionid",
+                                      (const xmlChar*)EDC_NAMESPACE);
+      bool IsSector = RegionId
+        && xmlStrcmp(RegionId, (const xmlChar*)SectorName.c_str()) == 0;
+      xmlFree(RegionId);
+
+      if (IsSector && ++nConfigFuseSector == 1)
+        {
+          xmlNodePtr FusesSectorNode = xmlTextReaderExpand(xReader);
+          if (FusesSectorNode == NULL)
+            break;
+
+          xpathCtx = xmlXPathNewContext(xmlTextReaderCurrentDoc(xReader));
+          if (xpathCtx == NULL)
+            {
+              sprintf (Error, "Unable to create new XPath context.");
+              return false;
+            }
+          if (!RegisterNamespaces())
+            {
+              sprintf (Error, "Unable to register XML namespaces.");
+              return false;
+            }
+
+          bool status = GetSectorNodeConfig (FusesSectorNode, SectorName,
+                                             Space, Error);
+          xmlXPathFreeContext(xpathCtx);
+          xpathCtx = NULL;
+          if (!status)
+            return false;
+        }
+
+      /* Skip the sector's subtree.  */
+      ret = xmlTextReaderNext(xReader);
+    }
+
+  if (ret != 0)
+    {
+      sprintf (Error, "Error in reading device file.");
+      return false;
+    }
+
+  if (nConfigFuseSector != 1) // FIXME currently assumes only one valid space
+  {
+    sprintf (Error, "No unique FUSES region in ConfigFuseSector, '%d' nodes found.",
+             nConfigFuseSector);
+    return false;
+  }
+
+  return true;
+}
+
 bool
 DXMLParser::GetSectorConfig (std::string SpaceName, std::string SectorName,
                              ConfigSpace &Space, char *Error)
 {
+  if (xStreaming)
+    return GetSectorConfigStream (SectorName, Space, Error);
+
   std::ostringstream ostr;
   ostr << "//edc:ConfigFuseSector[@edc:regionid='" << SectorName << "']";
 
@@ -268,21 +393,9 @@ DXMLParser::GetSectorConfig (std::string SpaceName, std::string SectorName,
     return false;
   }
 
-  uint32_t SectorAddress = 0; // FIXME assumed 0 as address, not used anywhere
-
   xmlNodePtr FusesSectorNode = xpathObj->nodesetval->nodeTab[0];
-  const char *Str = GetAttribute(FusesSectorNode, "beginaddr");
-  uint32_t saddress = strtol(Str, NULL, 0);
-  Str = GetAttribute(FusesSectorNode, "endaddr");
-  uint32_t eaddress = strtol(Str, NULL, 0);
-  uint32_t FuseSectorWidth = eaddress - saddress;
-
-  Space.SetValues(SectorName, SectorAddress, FuseSectorWidth);
-  if (!GetRegisterConfig (FusesSectorNode, Space))
-    {
-      sprintf (Error, "Error in reading config registers.");
-      return false;
-    }
+  if (!GetSectorNodeConfig (FusesSectorNode, SectorName, Space, Error))
+    return false;
 
   xmlXPathFreeObject(xpathObj);
   return true;
@@ -290,8 +403,118 @@ DXMLParser::GetSectorConfig (std::string SpaceName, std::string SectorName,
 
 #ifdef MAIN_TEST
 
+#include <ctime>
+#include <sys/resource.h>
+
 std::vector<class ConfigSpace> AvrConfigSpaces;
 
+/* Look up CName and ValName the way AvrDeviceConfig::SetConfig and
+   ConfigSpec::SetValue did before the name indexes were added.  */
+
+static bool
+LinearLookup (AvrDeviceConfig &Device, const std::string &CName,
+              const std::string &ValName)
+{
+  for (SpaceIterator S = Device.Spaces.begin(); S != Device.Spaces.end(); S++)
+    for (RegIterator R = S->registers.begin(); R != S->registers.end(); R++)
+      for (ConfigIterator C = R->configs.begin(); C != R->configs.end(); C++)
+        {
+          if (C->cname.compare(CName) != 0)
+            continue;
+          for (RefValIterator V = C->reference_values.begin();
+               V != C->reference_values.end(); V++)
+            if (V->first.compare(ValName) == 0)
+              return true;
+          return false;
+        }
+  return false;
+}
+
+static bool
+IndexedLookup (AvrDeviceConfig &Device, const std::string &CName,
+               const std::string &ValName)
+{
+  ConfigSpec *C = Device.FindConfig(CName, NULL);
+  return C && C->reference_index.find(ValName) != C->reference_index.end();
+}
+
+/* Micro-benchmark for the #pragma config setting lookup.  */
+
+static void
+BenchmarkSetConfigLookup (const char *File)
+{
+  AvrDeviceConfig Device;
+  if (!Device.LoadConfigurations(File))
+    {
+      std::cout << "Loading configurations failed.\n";
+      return;
+    }
+
+  std::vector<std::pair<std::string,std::string> > Settings;
+  for (SpaceIterator S = Device.Spaces.begin(); S != Device.Spaces.end(); S++)
+    for (RegIterator R = S->registers.begin(); R != S->registers.end(); R++)
+      for (ConfigIterator C = R->configs.begin(); C != R->configs.end(); C++)
+        for (RefValIterator V = C->reference_values.begin();
+             V != C->reference_values.end(); V++)
+          Settings.push_back(std::make_pair(C->cname, V->first));
+
+  if (Settings.empty())
+    return;
+
+  const unsigned Rounds = 20000;
+  unsigned Found = 0;
+  clock_t Start = clock();
+  for (unsigned i = 0; i < Rounds; i++)
+    for (size_t j = 0; j < Settings.size(); j++)
+      Found += LinearLookup(Device, Settings[j].first, Settings[j].second);
+  double Linear = (double) (clock() - Start) / CLOCKS_PER_SEC;
+
+  Start = clock();
+  for (unsigned i = 0; i < Rounds; i++)
+    for (size_t j = 0; j < Settings.size(); j++)
+      Found += IndexedLookup(Device, Settings[j].first, Settings[j].second);
+  double Indexed = (double) (clock() - Start) / CLOCKS_PER_SEC;
+
+  double Lookups = (double) Rounds * Settings.size();
+  std::cout << std::dec << "SetConfig lookup of " << Settings.size()
+            << " settings x " << Rounds << " (" << Found << " found):\n"
+            << "  linear:  " << Linear * 1e9 / Lookups << " ns/setting\n"
+            << "  indexed: " << Indexed * 1e9 / Lookups << " ns/setting\n";
+}
+
+/* Benchmark the streaming parser against the DOM parser.  The streaming
+   parser runs first so that its peak RSS is not hidden by the DOM's.  */
+
+static void
+BenchmarkParsers (const char *File)
+{
+  const unsigned Rounds = 20;
+  for (int Streaming = 1; Streaming >= 0; Streaming--)
+    {
+      clock_t Start = clock();
+      for (unsigned i = 0; i < Rounds; i++)
+        {
+          DXMLParser xmlParser (File, Streaming);
+          char ErrorMsg[255] = "";
+          ConfigSpace Space;
+          if (!xmlParser.Initialize()
+              || !xmlParser.GetSectorConfig("FusesSpace", "FUSES", Space,
+                                            ErrorMsg))
+            {
+              std::cout << "Parsing failed: " << ErrorMsg << std::endl;
+              return;
+            }
+        }
+      double Secs = (double) (clock() - Start) / CLOCKS_PER_SEC;
+
+      struct rusage Usage;
+      getrusage(RUSAGE_SELF, &Usage);
+      std::cout << std::dec << (Streaming ? "stream" : "DOM   ")
+                << " parser: " << Secs * 1e3 / Rounds << " ms/parse, "
+                << "peak RSS so far " << Usage.ru_maxrss << " KiB\n";
+    }
+}
+
 int main(int argc, char*argv[])
 {
   if (argc != 2)
@@ -299,7 +522,7 @@ int main(int argc, char*argv[])
       std::cout << "Usage: argv[0] <device xml file>\n";
       return 0;
     }
-  DXMLParser xmlParser (argv[1]);
+  DXMLParser xmlParser (argv[1], true);
   bool status = xmlParser.Initialize();
 
   if (!status) {
@@ -339,6 +562,9 @@ int main(int argc, char*argv[])
                  << "(" << (uint32_t)C->user_value << ")" << std::endl;
     }
 
+  BenchmarkSetConfigLookup(argv[1]);
+  BenchmarkParsers(argv[1]);
+
   return 0;
 }
 
@@ -4,6 +4,7 @@
 #include <libxml/parser.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/xmlreader.h>
 
 #include "avr-device-config.h"
 
@@ -16,12 +17,23 @@ class DXMLParser
 	bool ParserInitialized;
   std::string        xConfigFile;
 
-  DXMLParser(std::string XMLFile);
+  /* Streaming mode reads the file with an xmlTextReader and only builds
+     the subtree of the requested sector, DOM mode parses the whole
+     document and searches it with XPath.  */
+  bool               xStreaming;
+  xmlTextReaderPtr   xReader;
+
+  DXMLParser(std::string XMLFile, bool Streaming = false);
   ~DXMLParser();
   bool Initialize(void);
   bool GetSectorConfig (std::string SpaceName, std::string SectorName,
                         ConfigSpace &Space, char *Error);
  private:
+  bool GetSectorConfigStream (std::string SectorName, ConfigSpace &Space,
+                              char *Error);
+  bool GetSectorNodeConfig (xmlNodePtr SectorNode, std::string SectorName,
+                            ConfigSpace &Space, char *Error);
+  bool RegisterNamespaces (void);
   bool GetRegisterConfig (xmlNodePtr SectorNode, ConfigSpace &Space);
   bool GetFieldsConfig (xmlNodePtr RegNode, ConfigReg &Register);
 	bool GetConfigReferenceValues(xmlNodePtr FieldNode, std::string FName,
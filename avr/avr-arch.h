@@ -201,4 +201,24 @@ extern const avr_mcu_t avr_mcu_types[];
 extern void avr_inform_devices (void);
 extern void avr_inform_core_architectures (void);
 
+/* Device-specific properties as read from the device database, see
+   avr-devdb.h.  */
+
+typedef struct
+{
+  const char *name;
+  const char *macro;
+  enum avr_arch_id arch_id;
+  int dev_attribute;
+  int data_section_start;
+  int text_section_start;
+  unsigned int non_bit_addressable_registers_mask;
+  int flash_size;
+
+  /* Number of 64 KiB flash segments.  */
+  int n_flash;
+} avr_devdb_mcu_t;
+
+extern bool avr_devdb_lookup (const char *, const char *, avr_devdb_mcu_t *);
+
 #endif /* AVR_ARCH_H */
@@ -495,12 +495,9 @@ avr_handle_config_pragma (struct cpp_reader *pfile)
   enum cpp_ttype tok;
   tree tok_value;
   static int shown_no_config_warning = 0;
-  
-  if (flag_generate_lto)
-    {
-      warning (0, "#pragma config not supported with -flto option, this file will not participate in LTO");
-      flag_generate_lto = 0;
-    }
+
+  /* The device configurations are loaded lazily on the first pragma.  */
+  avr_load_device_configurations ();
 
   if (DeviceConfigurations.ConfigFile.empty())
     {
@@ -611,5 +608,8 @@ avr_handle_config_pragma (struct cpp_reader *pfile)
      clear the rest of the data on the line. */
   if (tok != CPP_EOF)
     CLEAR_REST_OF_INPUT_LINE();
+
+  /* Make the settings visible to LTO.  */
+  avr_update_config_asm ();
 }
 
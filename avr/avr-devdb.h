@@ -0,0 +1,87 @@
+/* Layout of the binary AVR device database.
+   Copyright (C) 2015 Free Software Foundation, Inc.
+
+This file is part of GCC.
+
+GCC is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+GCC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with GCC; see the file COPYING3.  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#ifndef AVR_DEVDB_H
+#define AVR_DEVDB_H
+
+/* The device database is written by gen-avr-mmcu-specs next to the
+   device-specs files and holds the same `avr_mcu_types' data.  It is a
+   single file that can be mapped as is: the driver looks up a device
+   with one hash probe instead of searching for and parsing its specs
+   file.
+
+   All words are 32-bit little endian.  The file starts with
+   AVR_DEVDB_HEADER_WORDS words of header, followed by the hash buckets,
+   the records and the string table:
+
+      header   magic[2], version, n_mcus, n_buckets, strtab offset,
+               strtab size, file size
+      buckets  n_buckets words: 1 + index of the first record in the
+               bucket's chain, 0 for an empty bucket
+      records  n_mcus records of AVR_DEVDB_RECORD_WORDS words, see below
+      strtab   NUL terminated strings; offset 0 is the empty string
+
+   A string field is a byte offset into the string table.  */
+
+#define AVR_DEVDB_FILE          "avr-devices.db"
+#define AVR_DEVDB_MAGIC         "AVRDEVDB"
+#define AVR_DEVDB_VERSION       1
+#define AVR_DEVDB_HEADER_WORDS  8
+
+/* Word indices in the header.  */
+enum
+{
+  AVR_DEVDB_H_VERSION = 2,
+  AVR_DEVDB_H_N_MCUS,
+  AVR_DEVDB_H_N_BUCKETS,
+  AVR_DEVDB_H_STRTAB,
+  AVR_DEVDB_H_STRTAB_SIZE,
+  AVR_DEVDB_H_FILE_SIZE
+};
+
+/* Word indices in a record.  */
+enum
+{
+  AVR_DEVDB_R_NAME,
+  AVR_DEVDB_R_MACRO,
+  AVR_DEVDB_R_ARCH_ID,
+  AVR_DEVDB_R_DEV_ATTRIBUTE,
+  AVR_DEVDB_R_DATA_SECTION_START,
+  AVR_DEVDB_R_TEXT_SECTION_START,
+  AVR_DEVDB_R_NON_BIT_ADDRESSABLE_MASK,
+  AVR_DEVDB_R_FLASH_SIZE,
+  AVR_DEVDB_R_N_FLASH,
+  AVR_DEVDB_R_NEXT,
+  AVR_DEVDB_RECORD_WORDS
+};
+
+/* FNV-1a hash of a device name, as used for the buckets.  */
+
+static inline unsigned int
+avr_devdb_hash (const char *name)
+{
+  unsigned int h = 2166136261u;
+
+  for (; *name; name++)
+    h = (h ^ (unsigned char) *name) * 16777619u;
+
+  return h;
+}
+
+#endif /* AVR_DEVDB_H */
@@ -1,11 +1,16 @@
 #include <stdlib.h>
+#include <string.h>
 #include <fstream>
 
 #include "avr-device-config.h"
 #include "DevXMLParse.h"
+#include "sha256.h"
 
 #include <assert.h>
 #include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 ConfigSpace::ConfigSpace() : isReferenced(false) {}
 
@@ -82,6 +87,7 @@ ConfigSpec::ConfigSpec(std::string name, uint8_t nbits,
                        uint8_t bpos, bool canEdit=true)
   :isModified(false)
 {
+  memset (reference_set, 0, sizeof (reference_set));
   cname = name;
   width = nbits;
   mask = (1 << width) - 1;
@@ -92,6 +98,7 @@ ConfigSpec::ConfigSpec(std::string name, uint8_t nbits,
 ConfigSpec::ConfigSpec(uint8_t nbits, uint8_t bpos, bool canEdit=true)
   :isModified(false)
 {
+  memset (reference_set, 0, sizeof (reference_set));
   cname = std::string("reserved");
   width = nbits;
   mask = (1 << width) - 1;
@@ -108,6 +115,11 @@ void ConfigSpec::SetDefaultValue(uint32_t RegDefaultVal)
 void ConfigSpec::AddRefValue(std::string id, uint8_t val)
 {
   reference_values.push_back (std::make_pair(id, val));
+
+  /* Index by name and by value for SetValue.  A later duplicate name
+     overrides an earlier one like the former linear search did.  */
+  reference_index[id] = val;
+  reference_set[val / 32] |= 1u << (val % 32);
 }
 
 // Set value for config. Returns false if not valid value
@@ -128,18 +140,23 @@ bool ConfigSpec::SetValue(std::string value)
       return true;
     }
 
-  bool IsRefFound = false;
-  for (RefValIterator R = reference_values.begin();
-       R != reference_values.end(); R++)
+  if (isNumber)
+    {
+      if (int_val > 0xff
+          || !(reference_set[int_val / 32] & (1u << (int_val % 32))))
+        return false;
+      user_value = int_val;
+    }
+  else
     {
-      if (isNumber ? R->second != int_val :
-                     R->first.compare(value) != 0)
-        continue;
-      IsRefFound = true;
+      RefValueIndex::iterator R = reference_index.find (value);
+      if (R == reference_index.end())
+        return false;
       user_value = R->second;
-      isModified = true;
     }
-  return IsRefFound;
+
+  isModified = true;
+  return true;
 }
 
 uint8_t ConfigSpec::GetValue()
@@ -170,10 +187,319 @@ ConfigSpec::Print(std::ostream &Stream)
 
 AvrDeviceConfig::AvrDeviceConfig()
 {
+  UseStreamingParser = true;
   AreConfigsLoaded = false;
   AreConfigsChanged = false;
 }
 
+/* Binary cache of the parsed configuration model.
+
+   Building the libxml2 DOM of a .pic file dominates the cost of
+   LoadConfigurations and every TU of a build parses the same file again.
+   Therefore the resulting Spaces are serialized to
+   <CacheDir>/<SHA-256 of the .pic path>.cfg along with the size, mtime and
+   SHA-256 digest of the .pic file.  The cache is used when size and mtime
+   still match or, if they don't (e.g. a re-installed DFP), when the content
+   digest still matches.  Otherwise the .pic file is parsed again and the
+   cache is rewritten.  All values are stored little endian.  */
+
+#define CONFIG_CACHE_MAGIC   "AVRCFGC"
+#define CONFIG_CACHE_VERSION 1
+
+struct ConfigFileStamp
+{
+  uint64_t size;
+  uint64_t mtime;
+  unsigned char digest[32];
+};
+
+class ConfigCacheWriter
+{
+ public:
+  std::string buf;
+
+  void Put8 (uint8_t val) { buf.append (1, (char) val); }
+  void Put32 (uint32_t val)
+  {
+    for (int i = 0; i < 32; i += 8)
+      Put8 ((uint8_t) (val >> i));
+  }
+  void Put64 (uint64_t val)
+  {
+    Put32 ((uint32_t) val);
+    Put32 ((uint32_t) (val >> 32));
+  }
+  void PutString (const std::string &str)
+  {
+    Put32 (str.length());
+    buf.append (str);
+  }
+};
+
+class ConfigCacheReader
+{
+ public:
+  const unsigned char *ptr;
+  const unsigned char *end;
+  bool valid;
+
+  ConfigCacheReader (const std::string &buf)
+    : ptr ((const unsigned char *) buf.data()),
+      end ((const unsigned char *) buf.data() + buf.length()),
+      valid (true) {}
+
+  uint8_t Get8 ()
+  {
+    if (ptr >= end)
+      {
+        valid = false;
+        return 0;
+      }
+    return *ptr++;
+  }
+  uint32_t Get32 ()
+  {
+    uint32_t val = 0;
+    for (int i = 0; i < 32; i += 8)
+      val |= (uint32_t) Get8 () << i;
+    return val;
+  }
+  uint64_t Get64 ()
+  {
+    uint64_t val = Get32 ();
+    return val | ((uint64_t) Get32 () << 32);
+  }
+  std::string GetString ()
+  {
+    uint32_t len = Get32 ();
+    if (!valid || (size_t) (end - ptr) < len)
+      {
+        valid = false;
+        return std::string();
+      }
+    std::string str ((const char *) ptr, len);
+    ptr += len;
+    return str;
+  }
+};
+
+static bool
+config_file_stat (std::string File, ConfigFileStamp &Stamp)
+{
+  struct stat buf;
+  if (stat (File.c_str(), &buf) != 0)
+    return false;
+
+  Stamp.size = buf.st_size;
+  Stamp.mtime = buf.st_mtime;
+  return true;
+}
+
+/* Read the whole FILE into BUF with a single read.  */
+
+static bool
+config_cache_read_file (std::string File, std::string &Buf)
+{
+  FILE *f = fopen (File.c_str(), "rb");
+  if (f == NULL)
+    return false;
+
+  struct stat st;
+  if (fstat (fileno (f), &st) != 0 || st.st_size <= 0)
+    {
+      fclose (f);
+      return false;
+    }
+
+  Buf.resize (st.st_size);
+  size_t n = fread (&Buf[0], 1, Buf.length(), f);
+  fclose (f);
+  return n == Buf.length();
+}
+
+std::string
+AvrDeviceConfig::GetCacheFileName()
+{
+  if (CacheDir.empty())
+    return std::string();
+
+  unsigned char digest[32];
+  sha256 ((const unsigned char *) ConfigFile.c_str(), ConfigFile.length(),
+          digest, 0);
+
+  char name[2 * 16 + 8] = "";
+  for (int i = 0; i < 16; i++)
+    sprintf (name + 2 * i, "%02x", digest[i]);
+  strcat (name, ".cfg");
+
+  std::string CacheFile = CacheDir;
+  char last = CacheFile[CacheFile.length() - 1];
+  if (last != '/' && last != '\\')
+    CacheFile.append (1, '/');
+  return CacheFile.append (name);
+}
+
+bool
+AvrDeviceConfig::LoadCache(std::string CacheFile)
+{
+  std::string Buf;
+  if (!config_cache_read_file (CacheFile, Buf))
+    return false;
+
+  ConfigCacheReader R (Buf);
+  if (Buf.length() < sizeof (CONFIG_CACHE_MAGIC)
+      || memcmp (Buf.data(), CONFIG_CACHE_MAGIC, sizeof (CONFIG_CACHE_MAGIC)))
+    return false;
+  R.ptr += sizeof (CONFIG_CACHE_MAGIC);
+
+  if (R.Get32 () != CONFIG_CACHE_VERSION
+      || R.GetString ().compare (ConfigFile) != 0)
+    return false;
+
+  ConfigFileStamp Cached;
+  Cached.size = R.Get64 ();
+  Cached.mtime = R.Get64 ();
+  for (int i = 0; i < 32; i++)
+    Cached.digest[i] = R.Get8 ();
+  if (!R.valid)
+    return false;
+
+  /* Size or mtime changed: the cache is still good if the contents are.  */
+  bool Restamp = false;
+  ConfigFileStamp Current;
+  if (!config_file_stat (ConfigFile, Current))
+    return false;
+  if (Current.size != Cached.size || Current.mtime != Cached.mtime)
+    {
+      if (Current.size != Cached.size
+          || sha256_file (ConfigFile.c_str(), Current.digest, 0) != 0
+          || memcmp (Current.digest, Cached.digest, 32) != 0)
+        return false;
+      Restamp = true;
+    }
+
+  std::vector<class ConfigSpace> CachedSpaces;
+  uint32_t nSpaces = R.Get32 ();
+  for (uint32_t s = 0; R.valid && s < nSpaces; s++)
+    {
+      ConfigSpace Space;
+      std::string SName = R.GetString ();
+      uint32_t SAddr = R.Get32 ();
+      Space.SetValues (SName, SAddr, R.Get32 ());
+
+      uint32_t nRegs = R.Get32 ();
+      for (uint32_t r = 0; R.valid && r < nRegs; r++)
+        {
+          std::string RName = R.GetString ();
+          uint8_t ROffset = R.Get8 ();
+          uint8_t RWidth = R.Get8 ();
+          ConfigReg Reg (RName, ROffset, RWidth, R.Get32 ());
+
+          uint32_t nConfigs = R.Get32 ();
+          for (uint32_t c = 0; R.valid && c < nConfigs; c++)
+            {
+              std::string CName = R.GetString ();
+              uint8_t CWidth = R.Get8 ();
+              uint8_t CBitPos = R.Get8 ();
+              uint8_t CEditable = R.Get8 ();
+              ConfigSpec Config (CName, CWidth, CBitPos, CEditable != 0);
+              Config.default_value = R.Get8 ();
+
+              uint32_t nRefValues = R.Get32 ();
+              for (uint32_t v = 0; R.valid && v < nRefValues; v++)
+                {
+                  std::string RefValName = R.GetString ();
+                  Config.AddRefValue (RefValName, R.Get8 ());
+                }
+              Reg.configs.push_back (Config);
+            }
+          Space.registers.push_back (Reg);
+        }
+      CachedSpaces.push_back (Space);
+    }
+
+  if (!R.valid || R.ptr != R.end)
+    return false;
+
+  Spaces = CachedSpaces;
+  if (Restamp)
+    SaveCache (CacheFile);
+  return true;
+}
+
+bool
+AvrDeviceConfig::SaveCache(std::string CacheFile)
+{
+  ConfigFileStamp Stamp;
+  if (!config_file_stat (ConfigFile, Stamp)
+      || sha256_file (ConfigFile.c_str(), Stamp.digest, 0) != 0)
+    return false;
+
+  ConfigCacheWriter W;
+  W.buf.append (CONFIG_CACHE_MAGIC, sizeof (CONFIG_CACHE_MAGIC));
+  W.Put32 (CONFIG_CACHE_VERSION);
+  W.PutString (ConfigFile);
+  W.Put64 (Stamp.size);
+  W.Put64 (Stamp.mtime);
+  for (int i = 0; i < 32; i++)
+    W.Put8 (Stamp.digest[i]);
+
+  W.Put32 (Spaces.size());
+  for (SpaceIterator S = Spaces.begin(); S != Spaces.end(); S++)
+    {
+      W.PutString (S->sname);
+      W.Put32 (S->address);
+      W.Put32 (S->width);
+      W.Put32 (S->registers.size());
+      for (RegIterator R = S->registers.begin(); R != S->registers.end(); R++)
+        {
+          W.PutString (R->rname);
+          W.Put8 (R->offset);
+          W.Put8 (R->width);
+          W.Put32 (R->factorydefault);
+          W.Put32 (R->configs.size());
+          for (ConfigIterator C = R->configs.begin(); C != R->configs.end(); C++)
+            {
+              W.PutString (C->cname);
+              W.Put8 (C->width);
+              W.Put8 (C->bitPos);
+              W.Put8 (C->isEditable);
+              W.Put8 (C->default_value);
+              W.Put32 (C->reference_values.size());
+              for (RefValIterator V = C->reference_values.begin();
+                   V != C->reference_values.end(); V++)
+                {
+                  W.PutString (V->first);
+                  W.Put8 (V->second);
+                }
+            }
+        }
+    }
+
+  /* Parallel compilations may race on the cache file: write a private
+     temporary and rename it into place.  */
+  char suffix[32] = "";
+  sprintf (suffix, ".%ld.tmp", (long) getpid());
+  std::string TmpFile = CacheFile + suffix;
+
+  FILE *f = fopen (TmpFile.c_str(), "wb");
+  if (f == NULL)
+    return false;
+  bool status = fwrite (W.buf.data(), 1, W.buf.length(), f) == W.buf.length();
+  status = (fclose (f) == 0) && status;
+
+#ifdef _WIN32
+  if (status)
+    remove (CacheFile.c_str());
+#endif
+  if (!status || rename (TmpFile.c_str(), CacheFile.c_str()) != 0)
+    {
+      remove (TmpFile.c_str());
+      return false;
+    }
+  return true;
+}
+
 bool AvrDeviceConfig::LoadConfigurations(std::string File)
 {
   if (File.empty()) return false;
@@ -183,7 +509,16 @@ bool AvrDeviceConfig::LoadConfigurations(std::string File)
 
   ConfigFile = File;
 
-  DXMLParser xmlParser (ConfigFile);
+  /* Try the binary cache first, it avoids libxml2 altogether.  */
+  std::string CacheFile = GetCacheFileName();
+  if (!CacheFile.empty() && LoadCache(CacheFile))
+    {
+      BuildConfigIndex();
+      AreConfigsLoaded = true;
+      return true;
+    }
+
+  DXMLParser xmlParser (ConfigFile, UseStreamingParser);
   bool status = xmlParser.Initialize();
 
   if (!status)
@@ -203,64 +538,79 @@ bool AvrDeviceConfig::LoadConfigurations(std::string File)
     }
 
   Spaces.push_back(FusesSpace);
+  BuildConfigIndex();
   AreConfigsLoaded = true;
+
+  if (!CacheFile.empty())
+    SaveCache(CacheFile);
   return true;
 }
 
+/* Index all configs by name.  The first config of a given name wins, like
+   the former search through Spaces, registers and configs did.  */
+
+void
+AvrDeviceConfig::BuildConfigIndex()
+{
+  Index.clear();
+  for (uint32_t s = 0; s < Spaces.size(); s++)
+    for (uint32_t r = 0; r < Spaces[s].registers.size(); r++)
+      for (uint32_t c = 0; c < Spaces[s].registers[r].configs.size(); c++)
+        {
+          ConfigLocation Loc = { s, r, c };
+          Index.insert (std::make_pair (Spaces[s].registers[r].configs[c].cname,
+                                        Loc));
+        }
+}
+
+ConfigSpec *
+AvrDeviceConfig::FindConfig(std::string config_name, ConfigSpace **Space)
+{
+  ConfigIndex::iterator I = Index.find (config_name);
+  if (I == Index.end())
+    return NULL;
+
+  ConfigLocation &Loc = I->second;
+  if (Space)
+    *Space = &Spaces[Loc.space];
+  return &Spaces[Loc.space].registers[Loc.reg].configs[Loc.config];
+}
+
 bool AvrDeviceConfig::SetConfig(std::string config_name, std::string value,
                                 char* Error)
 {
   assert (AreConfigsLoaded != false);
-  bool isConfigFound = false;
 
-  for (SpaceIterator itS = Spaces.begin();
-       itS != Spaces.end(); itS++)
+  ConfigSpace *Space = NULL;
+  ConfigSpec *Config = FindConfig (config_name, &Space);
+  if (Config == NULL)
     {
-      for (RegIterator itR = itS->registers.begin();
-           itR != itS->registers.end(); itR++)
-        {
-          for (ConfigIterator itC = itR->configs.begin();
-               itC != itR->configs.end(); itC++)
-            {
-              if (itC->cname.compare(config_name) != 0)
-                continue;
-
-              isConfigFound = true;
-              if (!itC->IsPermitted())
-                {
-                  sprintf (Error, "configuration setting '%s' is not writable",
-                           config_name.c_str());
-                  return false;
-                }
-
-              if (itC->isModified)
-                {
-                  sprintf (Error, "multiple definition for configuration setting '%s'",
-                           config_name.c_str());
-                  return false;
-                }
+      sprintf (Error, "unknown configuration setting: '%s'", config_name.c_str());
+      return false;
+    }
 
-              if (false == itC->SetValue(value))
-                {
-                  sprintf (Error, "unknown value for configuration '%s': '%s'",
-                         config_name.c_str(), value.c_str());
-                  return false;
-                }
+  if (!Config->IsPermitted())
+    {
+      sprintf (Error, "configuration setting '%s' is not writable",
+               config_name.c_str());
+      return false;
+    }
 
-              /* return as error issued or config set.  */
-              itS->isReferenced = true;
-              AreConfigsChanged = true;
-              return true;
-            }
-        }
+  if (Config->isModified)
+    {
+      sprintf (Error, "multiple definition for configuration setting '%s'",
+               config_name.c_str());
+      return false;
     }
 
-  if (!isConfigFound)
+  if (false == Config->SetValue(value))
     {
-      sprintf (Error, "unknown configuration setting: '%s'", config_name.c_str());
+      sprintf (Error, "unknown value for configuration '%s': '%s'",
+               config_name.c_str(), value.c_str());
       return false;
     }
 
-  assert (0);
+  Space->isReferenced = true;
+  AreConfigsChanged = true;
+  return true;
 }
-
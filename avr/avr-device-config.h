@@ -5,6 +5,30 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#if __cplusplus >= 201103L
+#include <unordered_map>
+#else
+#include <map>
+#endif
+
+class ConfigSpec;
+
+// position of a config as indexes into Spaces, registers and configs
+struct ConfigLocation
+{
+  uint32_t space;
+  uint32_t reg;
+  uint32_t config;
+};
+
+#if __cplusplus >= 201103L
+typedef std::unordered_map<std::string, uint8_t> RefValueIndex;
+typedef std::unordered_map<std::string, ConfigLocation> ConfigIndex;
+#else
+typedef std::map<std::string, uint8_t> RefValueIndex;
+typedef std::map<std::string, ConfigLocation> ConfigIndex;
+#endif
+
 class ConfigSpec
 {
   public:
@@ -15,6 +39,8 @@ class ConfigSpec
     uint8_t        default_value;  // edc:DCRDef[edc:factorydefault] & mask
     std::vector< std::pair<std::string,uint8_t> >
                    reference_values; // edc:DCRFieldSemantic[edc:cname],[edc:when]
+    RefValueIndex  reference_index; // reference value name -> value
+    uint32_t       reference_set[8]; // bitmap of reference values
     bool           isEditable;  // true if editable
     bool           isModified;  // true if user modified
     uint8_t        user_value;  // constant/ ID evaluated to one of reference_values
@@ -68,6 +94,8 @@ class AvrDeviceConfig
 {
  public:
 	std::string ConfigFile;
+	std::string CacheDir;  // binary cache directory, empty if disabled
+	bool UseStreamingParser;  // xmlTextReader instead of DOM + XPath
 	bool AreConfigsLoaded;
 	bool AreConfigsChanged;
 	std::vector<class ConfigSpace> Spaces;
@@ -75,12 +103,21 @@ class AvrDeviceConfig
 	//void SetConfigFile(std::string ConfigFile);
 	bool LoadConfigurations(std ::string config_file);
 	bool SetConfig(std::string cname, std::string value, char* err);
+	ConfigSpec *FindConfig(std::string cname, ConfigSpace **Space);
+ private:
+	ConfigIndex Index;  // config name -> location, built at load time
+	void BuildConfigIndex();
+	std::string GetCacheFileName();
+	bool LoadCache(std::string CacheFile);
+	bool SaveCache(std::string CacheFile);
 };
 
 extern int avr_load_configuration_values (std::string filename);
 extern void avr_handle_configuration_setting (std::string config_name,
                                               std::string value);
+extern void avr_load_device_configurations (void);
 extern void avr_output_configurations (void);
+extern void avr_update_config_asm (void);
 extern AvrDeviceConfig DeviceConfigurations;
 
 typedef std::vector<class ConfigSpace>::iterator SpaceIterator;
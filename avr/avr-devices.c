@@ -23,9 +23,13 @@
 #include "coretypes.h"
 #include "diagnostic.h"
 #include "tm.h"
+#ifdef HAVE_MMAP_FILE
+#include <sys/mman.h>
+#endif
 #endif /* IN_GEN_AVR_MMCU_TEXI */
 
 #include "avr-arch.h"
+#include "avr-devdb.h"
 
 /* List of all known AVR MCU architectures.
    Order as of enum avr_arch from avr.h.  */
@@ -217,4 +221,153 @@ avr_inform_core_architectures (void)
   free (archs);
 }
 
+
+/* The device database as mapped (or read) by avr_devdb_lookup.  */
+
+static char *devdb_file;
+static const unsigned char *devdb;
+static size_t devdb_size;
+
+static unsigned int
+devdb_word (size_t index)
+{
+  const unsigned char *p = devdb + 4 * index;
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+/* Map the device database DB_FILE and check its layout.  Return true
+   if it can be used.  */
+
+static bool
+devdb_open (const char *db_file)
+{
+  if (devdb_file && 0 == strcmp (devdb_file, db_file))
+    return devdb != NULL;
+
+  free (devdb_file);
+  devdb_file = xstrdup (db_file);
+  devdb = NULL;
+
+  int fd = open (db_file, O_RDONLY | O_BINARY);
+  struct stat st;
+
+  if (fd < 0)
+    return false;
+
+  if (fstat (fd, &st) != 0
+      || st.st_size < 4 * AVR_DEVDB_HEADER_WORDS)
+    {
+      close (fd);
+      return false;
+    }
+
+  size_t size = (size_t) st.st_size;
+  void *data;
+
+#ifdef HAVE_MMAP_FILE
+  data = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED)
+    data = NULL;
+#else
+  data = xmalloc (size);
+  if ((size_t) read (fd, data, size) != size)
+    {
+      free (data);
+      data = NULL;
+    }
+#endif
+  close (fd);
+
+  if (!data)
+    return false;
+
+  devdb = (const unsigned char*) data;
+  devdb_size = size;
+
+  unsigned int n_mcus = devdb_word (AVR_DEVDB_H_N_MCUS);
+  unsigned int n_buckets = devdb_word (AVR_DEVDB_H_N_BUCKETS);
+  unsigned int strtab = devdb_word (AVR_DEVDB_H_STRTAB);
+  unsigned int strtab_size = devdb_word (AVR_DEVDB_H_STRTAB_SIZE);
+
+  /* A database from another release or a truncated file is ignored,
+     the specs files are used then.  */
+
+  if (0 != memcmp (devdb, AVR_DEVDB_MAGIC, 8)
+      || devdb_word (AVR_DEVDB_H_VERSION) != AVR_DEVDB_VERSION
+      || devdb_word (AVR_DEVDB_H_FILE_SIZE) != size
+      || n_buckets == 0
+      || (n_buckets & (n_buckets - 1)) != 0
+      || strtab_size == 0
+      || strtab != 4 * (AVR_DEVDB_HEADER_WORDS + (size_t) n_buckets
+                        + (size_t) n_mcus * AVR_DEVDB_RECORD_WORDS)
+      || (size_t) strtab + strtab_size != size
+      || devdb[size - 1] != '\0')
+    {
+      devdb = NULL;
+      return false;
+    }
+
+  return true;
+}
+
+
+/* Look up device NAME in the device database DB_FILE.  On success fill
+   in MCU and return true.  Strings in MCU point into the database which
+   stays mapped.  */
+
+bool
+avr_devdb_lookup (const char *db_file, const char *name,
+                  avr_devdb_mcu_t *mcu)
+{
+  if (!devdb_open (db_file))
+    return false;
+
+  unsigned int n_mcus = devdb_word (AVR_DEVDB_H_N_MCUS);
+  unsigned int n_buckets = devdb_word (AVR_DEVDB_H_N_BUCKETS);
+  unsigned int strtab = devdb_word (AVR_DEVDB_H_STRTAB);
+  unsigned int strtab_size = devdb_word (AVR_DEVDB_H_STRTAB_SIZE);
+  size_t records = AVR_DEVDB_HEADER_WORDS + n_buckets;
+  const char *strings = (const char*) devdb + strtab;
+
+  unsigned int i = devdb_word (AVR_DEVDB_HEADER_WORDS
+                               + (avr_devdb_hash (name) & (n_buckets - 1)));
+
+  /* Chains are followed at most N_MCUS times so that a corrupt database
+     cannot loop.  */
+
+  for (unsigned int n = 0; i != 0 && i <= n_mcus && n < n_mcus; n++)
+    {
+      size_t r = records + (size_t) (i - 1) * AVR_DEVDB_RECORD_WORDS;
+      unsigned int name_off = devdb_word (r + AVR_DEVDB_R_NAME);
+      unsigned int macro_off = devdb_word (r + AVR_DEVDB_R_MACRO);
+      unsigned int arch_id = devdb_word (r + AVR_DEVDB_R_ARCH_ID);
+
+      if (name_off < strtab_size
+          && macro_off < strtab_size
+          && 0 == strcmp (strings + name_off, name))
+        {
+          if (arch_id == ARCH_UNKNOWN || arch_id > ARCH_AVRXMEGA7)
+            return false;
+
+          mcu->name = strings + name_off;
+          mcu->macro = strings + macro_off;
+          mcu->arch_id = (enum avr_arch_id) arch_id;
+          mcu->dev_attribute = devdb_word (r + AVR_DEVDB_R_DEV_ATTRIBUTE);
+          mcu->data_section_start
+            = devdb_word (r + AVR_DEVDB_R_DATA_SECTION_START);
+          mcu->text_section_start
+            = devdb_word (r + AVR_DEVDB_R_TEXT_SECTION_START);
+          mcu->non_bit_addressable_registers_mask
+            = devdb_word (r + AVR_DEVDB_R_NON_BIT_ADDRESSABLE_MASK);
+          mcu->flash_size = devdb_word (r + AVR_DEVDB_R_FLASH_SIZE);
+          mcu->n_flash = devdb_word (r + AVR_DEVDB_R_N_FLASH);
+          return true;
+        }
+
+      i = devdb_word (r + AVR_DEVDB_R_NEXT);
+    }
+
+  return false;
+}
+
 #endif // IN_GEN_AVR_MMCU_TEXI
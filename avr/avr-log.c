@@ -40,6 +40,7 @@
 #include "function.h"
 #include "tm_p.h"
 #include "tree-pass.h"	/* for current_pass */
+#include <sys/time.h>
 
 /* This file supplies some functions for AVR back-end developers
    with a printf-like interface.  The functions are called through
@@ -318,6 +319,7 @@ avr_log_set_avr_log (void)
       SET_DUMP_DETAIL (legitimize_reload_address);
       SET_DUMP_DETAIL (progmem);
       SET_DUMP_DETAIL (rtx_costs);
+      SET_DUMP_DETAIL (startup);
 
 #undef SET_DUMP_DETAIL
 
@@ -325,3 +327,110 @@ avr_log_set_avr_log (void)
         fprintf (stderr, "?\n\n");
     }
 }
+
+
+/* Time the AVR specific startup stages for -mtime-report.  The times of
+   a stage are accumulated in microseconds and reported (and reset) at the
+   end of each TU by avr_time_report_output.  */
+
+static const char *const avr_time_stage_name[AVR_TIME_STAGE_COUNT] =
+  {
+    "licensed_options",
+    "license_check",
+    "find_device_config",
+    "load_configurations",
+    "core_architecture"
+  };
+
+static struct
+{
+  long long start;
+  long long usec;
+  bool measured;
+} avr_time_stages[AVR_TIME_STAGE_COUNT];
+
+/* Wall clock time in microseconds.  */
+
+long long
+avr_time_usec (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+void
+avr_time_start (enum avr_time_stage stage)
+{
+  avr_time_stages[stage].start = avr_time_usec ();
+}
+
+void
+avr_time_stop (enum avr_time_stage stage)
+{
+  avr_time_stages[stage].usec
+    += avr_time_usec () - avr_time_stages[stage].start;
+  avr_time_stages[stage].measured = true;
+}
+
+void
+avr_time_report_output (void)
+{
+  char buf[1024];
+  char *p = buf;
+  int i;
+
+  if (avr_time_report || avr_time_report_file)
+    {
+      if (avr_time_report_file)
+        {
+          /* One JSON object per line so that a build can append the
+             reports of all its compilations to the same file.  A stage
+             that did not run for this TU is null.  */
+
+          p += snprintf (p, buf + sizeof (buf) - p, "{\"mmcu\": \"%s\"",
+                         avr_mmcu ? avr_mmcu : "");
+          for (i = 0; i < AVR_TIME_STAGE_COUNT; i++)
+            if (avr_time_stages[i].measured)
+              p += snprintf (p, buf + sizeof (buf) - p, ", \"%s\": %lld",
+                             avr_time_stage_name[i], avr_time_stages[i].usec);
+            else
+              p += snprintf (p, buf + sizeof (buf) - p, ", \"%s\": null",
+                             avr_time_stage_name[i]);
+          if (avr_driver_specs_time >= 0)
+            p += snprintf (p, buf + sizeof (buf) - p,
+                           ", \"driver_device_specs\": %d",
+                           avr_driver_specs_time);
+          snprintf (p, buf + sizeof (buf) - p, "}\n");
+
+          if (0 == strcmp (avr_time_report_file, "-"))
+            fputs (buf, stderr);
+          else
+            {
+              FILE *f = fopen (avr_time_report_file, "a");
+              if (f)
+                {
+                  fputs (buf, f);
+                  fclose (f);
+                }
+              else
+                warning (0, "cannot open %qs for writing: %m",
+                         avr_time_report_file);
+            }
+        }
+
+      if (avr_time_report)
+        {
+          fprintf (stderr, "\nAVR startup times (usec):\n");
+          for (i = 0; i < AVR_TIME_STAGE_COUNT; i++)
+            if (avr_time_stages[i].measured)
+              fprintf (stderr, " %-22s: %10lld\n", avr_time_stage_name[i],
+                       avr_time_stages[i].usec);
+          if (avr_driver_specs_time >= 0)
+            fprintf (stderr, " %-22s: %10d\n", "driver_device_specs",
+                     avr_driver_specs_time);
+        }
+    }
+
+  memset (avr_time_stages, 0, sizeof (avr_time_stages));
+}
@@ -57,6 +57,10 @@ extern const char *avr_out_tsthi (rtx_insn *, rtx*, int*);
 extern const char *avr_out_tstpsi (rtx_insn *, rtx*, int*);
 extern const char *avr_out_compare (rtx_insn *, rtx*, int*);
 extern const char *avr_out_compare64 (rtx_insn *, rtx*, int*);
+extern const char *avr_out_shift64 (rtx_insn *, rtx*, int*);
+extern const char *avr_out_mulsidi3 (rtx_insn *, rtx*, int*);
+extern const char *avr_out_mul_fixed (rtx_insn *, rtx*, int*);
+extern bool avr_shift64_inline_p (enum rtx_code, rtx);
 extern const char *ret_cond_branch (rtx x, int len, int reverse);
 extern const char *avr_out_movpsi (rtx_insn *, rtx*, int*);
 extern const char *avr_out_sign_extend (rtx_insn *, rtx*, int*);
@@ -90,9 +94,14 @@ extern int avr_starting_frame_offset (void);
 
 extern void avr_output_addr_vec_elt (FILE *stream, int value);
 extern const char *avr_out_sbxx_branch (rtx_insn *insn, rtx operands[]);
+extern const char* avr_out_doloop_end (rtx_insn *, rtx*);
+extern const char* avr_out_skip_mov (rtx_insn *, rtx*, int*);
 extern const char* avr_out_bitop (rtx, rtx*, int*);
 extern const char* avr_out_plus (rtx, rtx*, int* =NULL, int* =NULL, bool =true);
 extern const char* avr_out_round (rtx_insn *, rtx*, int* =NULL);
+extern const char* avr_out_ss_abs_neg (rtx_insn *, rtx*, int*);
+extern const char* avr_out_bitcount (rtx_insn *, rtx*, int*);
+extern const char* avr_out_isr_saves (rtx*, int*);
 extern const char* avr_out_addto_sp (rtx*, int*);
 extern const char* avr_out_xload (rtx_insn *, rtx*, int*);
 extern const char* avr_out_movmem (rtx_insn *, rtx*, int*);
@@ -129,6 +138,7 @@ extern bool avr_mem_flash_p (rtx);
 extern bool avr_mem_memx_p (rtx);
 extern bool avr_load_libgcc_p (rtx);
 extern bool avr_xload_libgcc_p (machine_mode);
+extern bool avr_doloop_mode_p (machine_mode, rtx);
 extern rtx avr_eval_addr_attrib (rtx x);
 
 static inline unsigned
@@ -141,6 +151,9 @@ extern void avr_fix_inputs (rtx*, unsigned, unsigned);
 extern bool avr_emit2_fix_outputs (rtx (*)(rtx,rtx), rtx*, unsigned, unsigned);
 extern bool avr_emit3_fix_outputs (rtx (*)(rtx,rtx,rtx), rtx*, unsigned, unsigned);
 extern void avr_fix_memx_all8_inputs (rtx *, unsigned);
+extern bool avr_mul_inline_p (machine_mode, bool);
+extern bool avr_emit_mul_csd (machine_mode, rtx*);
+extern bool avr_emit_div_fixed_const (enum rtx_code, rtx*);
 
 extern rtx lpm_reg_rtx;
 extern rtx lpm_addr_reg_rtx;
@@ -176,6 +189,7 @@ typedef struct
   unsigned legitimize_reload_address :1;
   unsigned progmem :1;
   unsigned rtx_costs :1;
+  unsigned startup :1;
 } avr_log_t;
 
 extern avr_log_t avr_log;
@@ -189,6 +203,23 @@ extern avr_lang_extn_t avr_lang_extn;
 #define TARGET_CCI  (avr_lang_extn == LANG_EXTN_CCI)
 extern void avr_output_configurations (void);
 extern void avr_override_licensed_options(void);
+extern const char *avr_user_cache_directory (void);
+
+/* Startup stages timed by -mtime-report, see avr-log.c.  */
+enum avr_time_stage
+{
+  AVR_TIME_LICENSED_OPTIONS,
+  AVR_TIME_LICENSE_CHECK,
+  AVR_TIME_FIND_DEVICE_CONFIG,
+  AVR_TIME_LOAD_CONFIGURATIONS,
+  AVR_TIME_CORE_ARCHITECTURE,
+  AVR_TIME_STAGE_COUNT
+};
+
+extern long long avr_time_usec (void);
+extern void avr_time_start (enum avr_time_stage);
+extern void avr_time_stop (enum avr_time_stage);
+extern void avr_time_report_output (void);
 extern const char* avr_text_section_asm_op();
 extern const char* avr_data_section_asm_op();
 extern const char* avr_bss_section_asm_op();
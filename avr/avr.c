@@ -82,12 +82,19 @@
 #include "cfgcleanup.h"
 #include "predict.h"
 #include "basic-block.h"
+#include "cfgloop.h"
+#include "hash-map.h"
+#include "is-a.h"
+#include "plugin-api.h"
+#include "ipa-ref.h"
+#include "cgraph.h"
 #include "df.h"
 #include "builtins.h"
 #include "context.h"
 #include "tree-pass.h"
 #include "vec.h"
 #include "opts.h"
+#include "toplev.h"
 #include <dirent.h>
 
 #include "avr-device-config.h"
@@ -137,6 +144,15 @@
 #define AVR_TMP_REGNO (AVR_TINY ? TMP_REGNO_TINY : TMP_REGNO)
 #define AVR_ZERO_REGNO (AVR_TINY ? ZERO_REGNO_TINY : ZERO_REGNO)
 
+/* Registers saved by "isr_saves" in the prologue of an ISR.  */
+enum
+  {
+    AVR_ISR_TMP  = 1 << 0,
+    AVR_ISR_ZERO = 1 << 1,
+    AVR_ISR_SREG = 1 << 2,
+    AVR_ISR_ALL  = AVR_ISR_TMP | AVR_ISR_ZERO | AVR_ISR_SREG
+  };
+
 /* Known address spaces.  The order must be the same as in the respective
    enum from avr.h (or designated initialized must be used).  */
 const avr_addrspace_t avr_addrspace[ADDR_SPACE_COUNT] =
@@ -383,6 +399,129 @@ public:
 }; // avr_pass_recompute_notes
 
 
+static void avr_isr_scan_saves (void);
+
+static const pass_data avr_pass_data_isr_saves =
+{
+  RTL_PASS,      // type
+  "",            // name (will be patched)
+  OPTGROUP_NONE, // optinfo_flags
+  TV_MACH_DEP,   // tv_id
+  0,             // properties_required
+  0,             // properties_provided
+  0,             // properties_destroyed
+  0,             // todo_flags_start
+  0              // todo_flags_finish
+};
+
+
+class avr_pass_isr_saves : public rtl_opt_pass
+{
+public:
+  avr_pass_isr_saves (gcc::context *ctxt, const char *name)
+    : rtl_opt_pass (avr_pass_data_isr_saves, ctxt)
+  {
+    this->name = name;
+  }
+
+  virtual bool gate (function *fun)
+  {
+    return (optimize
+            && avr_minimal_isr_prologues
+            && (fun->machine->is_interrupt || fun->machine->is_signal)
+            && !fun->machine->is_naked);
+  }
+
+  virtual unsigned int execute (function*)
+  {
+    avr_isr_scan_saves ();
+
+    return 0;
+  }
+}; // avr_pass_isr_saves
+
+
+static void avr_isr_vector_slot (void);
+
+static const pass_data avr_pass_data_vector_slot =
+{
+  RTL_PASS,      // type
+  "",            // name (will be patched)
+  OPTGROUP_NONE, // optinfo_flags
+  TV_MACH_DEP,   // tv_id
+  0,             // properties_required
+  0,             // properties_provided
+  0,             // properties_destroyed
+  0,             // todo_flags_start
+  0              // todo_flags_finish
+};
+
+
+class avr_pass_vector_slot : public rtl_opt_pass
+{
+public:
+  avr_pass_vector_slot (gcc::context *ctxt, const char *name)
+    : rtl_opt_pass (avr_pass_data_vector_slot, ctxt)
+  {
+    this->name = name;
+  }
+
+  virtual bool gate (function *fun)
+  {
+    return (fun->machine->is_interrupt || fun->machine->is_signal)
+      && (avr_vector_slot_isrs
+          || lookup_attribute ("vector_slot",
+                               DECL_ATTRIBUTES (fun->decl)));
+  }
+
+  virtual unsigned int execute (function*)
+  {
+    avr_isr_vector_slot ();
+
+    return 0;
+  }
+}; // avr_pass_vector_slot
+
+
+static void avr_compare_elim (void);
+
+static const pass_data avr_pass_data_compare_elim =
+{
+  RTL_PASS,      // type
+  "",            // name (will be patched)
+  OPTGROUP_NONE, // optinfo_flags
+  TV_MACH_DEP,   // tv_id
+  0,             // properties_required
+  0,             // properties_provided
+  0,             // properties_destroyed
+  0,             // todo_flags_start
+  0              // todo_flags_finish
+};
+
+
+class avr_pass_compare_elim : public rtl_opt_pass
+{
+public:
+  avr_pass_compare_elim (gcc::context *ctxt, const char *name)
+    : rtl_opt_pass (avr_pass_data_compare_elim, ctxt)
+  {
+    this->name = name;
+  }
+
+  virtual bool gate (function*)
+  {
+    return optimize > 0 && flag_compare_elim_after_reload;
+  }
+
+  virtual unsigned int execute (function*)
+  {
+    avr_compare_elim ();
+
+    return 0;
+  }
+}; // avr_pass_compare_elim
+
+
 static void
 avr_register_passes (void)
 {
@@ -396,6 +535,27 @@ avr_register_passes (void)
 
   register_pass (new avr_pass_recompute_notes (g, "avr-notes-free-cfg"),
                  PASS_POS_INSERT_BEFORE, "*free_cfg", 1);
+
+  /* Delete compares whose flags are already provided by the code that
+     falls through or jumps to them.  Final only does this within a basic
+     block.  This must run after `avr_reorg' which rewrites compares.  */
+
+  register_pass (new avr_pass_compare_elim (g, "avr-compare-elim"),
+                 PASS_POS_INSERT_AFTER, "mach", 1);
+
+  /* Find out which of SREG, __tmp_reg__ and __zero_reg__ an ISR uses so
+     that the prologue only saves what is needed.  This runs after branch
+     shortening so that dropping saves cannot push a branch out of range,
+     and before the CFI is computed from the prologue.  */
+
+  register_pass (new avr_pass_isr_saves (g, "avr-isr-saves"),
+                 PASS_POS_INSERT_AFTER, "shorten", 1);
+
+  /* Put short ISRs right into their vector slots.  This needs the final
+     insn lengths including the ones of the "isr_saves" insns.  */
+
+  register_pass (new avr_pass_vector_slot (g, "avr-vector-slot"),
+                 PASS_POS_INSERT_AFTER, "avr-isr-saves", 1);
 }
 
 
@@ -501,6 +661,52 @@ avr_handle_deferred_options(void) {
 
 static const char dir_separator_str[] = { DIR_SEPARATOR, 0 };
 
+/* Return the per-user cache directory $XDG_CACHE_HOME/xc8 resp.
+   $HOME/.cache/xc8, creating it if needed, or NULL if there is none.  */
+
+const char*
+avr_user_cache_directory (void)
+{
+  static bool initialized = false;
+  static char *dir = NULL;
+
+  if (initialized)
+    return dir;
+  initialized = true;
+
+  const char *base = getenv ("XDG_CACHE_HOME");
+  if (base && *base)
+    dir = concat (base, dir_separator_str, "xc8", NULL);
+  else if ((base = getenv ("HOME")) && *base)
+    {
+      char *cache = concat (base, dir_separator_str, ".cache", NULL);
+      mkdir (cache, 0700);
+      dir = concat (cache, dir_separator_str, "xc8", NULL);
+      free (cache);
+    }
+  else
+    return NULL;
+
+  /* The cache is per-user, don't share it.  */
+  mkdir (dir, 0700);
+  return dir;
+}
+
+/* Return the directory for the binary device configuration cache, or NULL
+   if caching is disabled or no directory can be determined.  */
+
+static const char*
+avr_config_cache_directory (void)
+{
+  if (!avr_config_cache)
+    return NULL;
+
+  if (avr_config_cache_dir)
+    return avr_config_cache_dir[0] ? avr_config_cache_dir : NULL;
+
+  return avr_user_cache_directory ();
+}
+
 std::string str_tolower(std::string s)
 {
   uint32_t i = 0;
@@ -515,29 +721,243 @@ std::string str_tolower(std::string s)
   return lname;
 }
 
+/* Canonical spelling of device NAME as used for the DFP's .pic files,
+   e.g. atmega328p -> ATmega328P and avr128da48 -> AVR128DA48.  */
+
+static std::string
+avr_canonical_device_name (const char *name)
+{
+  static const char *const prefixes[] = { "ATmega", "ATtiny", "ATxmega" };
+  std::string cname;
+
+  for (const char *p = name; *p; p++)
+    cname.append (1, (char) TOUPPER (*p));
+
+  for (size_t i = 0; i < ARRAY_SIZE (prefixes); i++)
+    if (strncasecmp (cname.c_str(), prefixes[i], strlen (prefixes[i])) == 0)
+      {
+        cname.replace (0, strlen (prefixes[i]), prefixes[i]);
+        break;
+      }
+
+  return cname;
+}
+
+static bool
+avr_regular_file_p (const char *path)
+{
+  struct stat buf;
+  return stat (path, &buf) == 0 && S_ISREG (buf.st_mode);
+}
+
+/* The index of the .pic files of a DFP's edc directory lives in the
+   configuration cache.  Its first two lines are the directory and its
+   mtime, followed by "<lower-case name>\t<file name>" lines.  */
+
+static char*
+avr_device_index_file (const char *config_dir)
+{
+  const char *cache_dir = avr_config_cache_directory ();
+  if (!cache_dir)
+    return NULL;
+
+  char name[32];
+  sprintf (name, "edc-%08x.idx", (unsigned) htab_hash_string (config_dir));
+  return concat (cache_dir, dir_separator_str, name, NULL);
+}
+
+/* Look up TNAME in INDEX_FILE.  Return 1 and set CONFIG_FILE if found, 0 if
+   the index is up to date but doesn't know TNAME, and -1 if the index is
+   missing, stale or malformed.  */
+
+static int
+avr_lookup_device_index (const char *index_file, const char *config_dir,
+                         time_t dir_mtime, const char *tname,
+                         char *config_file)
+{
+  FILE *f = fopen (index_file, "r");
+  if (f == NULL)
+    return -1;
+
+  char line[512];
+  const char *dir = NULL;
+  int result = -1;
+
+  if (fgets (line, sizeof (line), f)
+      && (dir = strtok (line, "\n")) == NULL)
+    warning (0, "ignoring malformed device index %qs", index_file);
+  else if (dir != NULL
+           && strcmp (dir, config_dir) == 0
+           && fgets (line, sizeof (line), f)
+           && strtoll (line, NULL, 10) == (long long) dir_mtime)
+    {
+      result = 0;
+      while (fgets (line, sizeof (line), f))
+        {
+          char *tab = strchr (line, '\t');
+          if (tab == NULL)
+            continue;
+          *tab = '\0';
+          if (strcmp (line, tname) != 0)
+            continue;
+
+          const char *name = strtok (tab + 1, "\n");
+          if (name == NULL)
+            {
+              warning (0, "ignoring malformed device index %qs", index_file);
+              result = -1;
+              break;
+            }
+
+          sprintf (config_file, "%s%s%s", config_dir, dir_separator_str,
+                   name);
+          result = 1;
+          break;
+        }
+    }
+
+  fclose (f);
+  return result;
+}
+
+static void
+avr_write_device_index (const char *index_file, const char *config_dir,
+                        time_t dir_mtime, const std::string &entries)
+{
+  char *tmp_file = (char *) xmalloc (strlen (index_file) + 32);
+  sprintf (tmp_file, "%s.%ld.tmp", index_file, (long) getpid ());
+
+  FILE *f = fopen (tmp_file, "w");
+  if (f == NULL)
+    {
+      free (tmp_file);
+      return;
+    }
+
+  fprintf (f, "%s\n%lld\n%s", config_dir, (long long) dir_mtime,
+           entries.c_str());
+  if (fclose (f) != 0 || rename (tmp_file, index_file) != 0)
+    remove (tmp_file);
+  free (tmp_file);
+}
+
+/* Find the .pic file of MCU_NAME in CONFIG_DIR and write its path to
+   CONFIG_FILE, which is left empty if there is none.  File names are
+   matched case-insensitively.  The exact and the canonical spelling are
+   tried first, then the per-DFP index and, as a last resort, the directory
+   is scanned and the index (re)generated.  */
+
 void avr_find_device_config_file(const char* config_dir, const char* mcu_name, char* config_file)
 {
+  std::string tname = str_tolower (std::string (mcu_name)) + ".pic";
+  std::string cname = avr_canonical_device_name (mcu_name);
+  const char *candidates[] =
+    {
+      concat (mcu_name, ".pic", NULL),
+      concat (cname.c_str(), ".PIC", NULL),
+      concat (cname.c_str(), ".pic", NULL),
+      concat (mcu_name, ".PIC", NULL)
+    };
+
+  config_file[0] = '\0';
+  for (size_t i = 0; i < ARRAY_SIZE (candidates); i++)
+    {
+      char *path = concat (config_dir, dir_separator_str, candidates[i], NULL);
+      if (!config_file[0] && avr_regular_file_p (path))
+        strcpy (config_file, path);
+      free (path);
+      free (const_cast<char *> (candidates[i]));
+    }
+  if (config_file[0])
+    return;
+
+  struct stat dir_stat;
+  if (stat (config_dir, &dir_stat) != 0)
+    return;
+
+  char *index_file = avr_device_index_file (config_dir);
+  if (index_file)
+    {
+      int found = avr_lookup_device_index (index_file, config_dir,
+                                           dir_stat.st_mtime, tname.c_str(),
+                                           config_file);
+      if (found == 0
+          || (found == 1 && avr_regular_file_p (config_file)))
+        {
+          free (index_file);
+          return;
+        }
+      config_file[0] = '\0';
+    }
+
   DIR* dir = opendir(config_dir);
-  if (dir == NULL) return;
-  char tname[128] = {0};
-  sprintf (tname, "%s.pic", mcu_name);
+  if (dir == NULL)
+    {
+      free (index_file);
+      return;
+    }
 
+  /* Only the matching entry is stat'ed, the index records all .pic names.  */
+  std::string entries;
   struct dirent* dentry;
-  while (dentry = readdir(dir))
+  while ((dentry = readdir(dir)))
     {
-      struct stat buf;
-      if (stat(concat(config_dir, dir_separator_str, dentry->d_name, NULL),
-               &buf) != 0) continue;
-      if (!S_ISREG(buf.st_mode)) continue;
-
       std::string lnamestr = str_tolower(std::string(dentry->d_name));
+      size_t len = lnamestr.length();
+
+      if (len < 4 || lnamestr.compare (len - 4, 4, ".pic") != 0)
+        continue;
 
-      if (strcmp(tname, lnamestr.c_str()) != 0) continue;
+      entries += lnamestr + "\t" + dentry->d_name + "\n";
+
+      if (config_file[0] || lnamestr != tname)
+        continue;
 
       sprintf (config_file, "%s%s%s", config_dir, dir_separator_str, dentry->d_name);
-      break;
+      if (!avr_regular_file_p (config_file))
+        config_file[0] = '\0';
     }
   closedir(dir);
+
+  if (index_file)
+    {
+      avr_write_device_index (index_file, config_dir, dir_stat.st_mtime,
+                              entries);
+      free (index_file);
+    }
+}
+
+/* Locate and load the device configurations, if DFP path and device are
+   specified.  Only TUs that use #pragma config need them, hence this is
+   not done by avr_option_override but on first use.  */
+
+void
+avr_load_device_configurations (void)
+{
+  static bool attempted = false;
+
+  if (attempted)
+    return;
+  attempted = true;
+
+  if (avr_dfp_path && avr_device)
+    {
+      char config_file[255] = {0};
+      avr_time_start (AVR_TIME_FIND_DEVICE_CONFIG);
+      avr_find_device_config_file(concat(avr_dfp_path, dir_separator_str, "edc", dir_separator_str, NULL),
+                                  avr_device, config_file);
+      avr_time_stop (AVR_TIME_FIND_DEVICE_CONFIG);
+      if (config_file[0] != 0)
+        {
+          const char *cache_dir = avr_config_cache_directory ();
+          if (cache_dir)
+            DeviceConfigurations.CacheDir = cache_dir;
+          DeviceConfigurations.UseStreamingParser = !avr_config_xml_dom;
+          avr_time_start (AVR_TIME_LOAD_CONFIGURATIONS);
+          DeviceConfigurations.LoadConfigurations(config_file);
+          avr_time_stop (AVR_TIME_LOAD_CONFIGURATIONS);
+        }
+    }
 }
 
 /* Implement `TARGET_OPTION_OVERRIDE'.  */
@@ -545,7 +965,12 @@ void avr_find_device_config_file(const char* config_dir, const char* mcu_name, c
 static void
 avr_option_override (void)
 {
+  /* Set up -mlog= first so that the license check can be logged, too.  */
+  avr_log_set_avr_log();
+
+  avr_time_start (AVR_TIME_LICENSED_OPTIONS);
 	avr_override_licensed_options();
+  avr_time_stop (AVR_TIME_LICENSED_OPTIONS);
 
   /* Disable -fdelete-null-pointer-checks option for AVR target.
      This option compiler assumes that dereferencing of a null pointer
@@ -595,7 +1020,11 @@ avr_option_override (void)
   if (flag_pie == 2)
     warning (OPT_fPIE, "-fPIE is not supported");
 
-  if (!avr_set_core_architecture())
+  avr_time_start (AVR_TIME_CORE_ARCHITECTURE);
+  bool known_arch = avr_set_core_architecture ();
+  avr_time_stop (AVR_TIME_CORE_ARCHITECTURE);
+
+  if (!known_arch)
     return;
 
 /*
@@ -630,20 +1059,8 @@ avr_option_override (void)
   if (!global_options_set.x_dwarf_version)
     dwarf_version = 2;
 
-  avr_log_set_avr_log();
-
 	avr_handle_deferred_options();
 
-  /* Load device configurations, if DFP path and device are specified.  */
-  if (avr_dfp_path && avr_device)
-    {
-      char config_file[255] = {0};
-      avr_find_device_config_file(concat(avr_dfp_path, dir_separator_str, "edc", dir_separator_str, NULL),
-                                  avr_device, config_file);
-      if (config_file[0] != 0)
-        DeviceConfigurations.LoadConfigurations(config_file);
-    }
-
   /* Register some avr-specific pass(es).  There is no canonical place for
      pass registration.  This function is convenient.  */
 
@@ -917,6 +1334,15 @@ avr_set_current_function (tree decl)
     warning_at (loc, OPT_Wattributes, "function attributes %qs and %qs have"
                 " no effect on %qs function", "OS_task", "OS_main", "naked");
 
+  /* 'vector_slot' is only implemented for ISRs, cf. avr_isr_vector_slot.  */
+
+  if (!cfun->machine->is_interrupt
+      && !cfun->machine->is_signal
+      && lookup_attribute ("vector_slot", DECL_ATTRIBUTES (decl)))
+    warning_at (loc, OPT_Wattributes, "%qs attribute ignored: it only applies"
+                " to %qs and %qs functions", "vector_slot", "interrupt",
+                "signal");
+
   if (cfun->machine->is_interrupt || cfun->machine->is_signal 
           || cfun->machine->is_nmi)
     {
@@ -1003,42 +1429,148 @@ avr_starting_frame_offset (void)
 }
 
 
-/* Return the number of hard registers to push/pop in the prologue/epilogue
-   of the current function, and optionally store these registers in SET.  */
+/* Registers FIRST...LAST that the libgcc helpers called as ordinary
+   functions might change, as documented in libgcc's lib1funcs.S.  Most
+   helpers are insns of type "xcall" that describe their register usage
+   in RTL and hence don't show up here.  */
 
-static int
-avr_regs_to_save (HARD_REG_SET *set)
+static const struct
 {
-  int reg, count;
-  int int_or_sig_p = cfun->machine->is_interrupt || cfun->machine->is_signal;
+  const char *name;
+  int first, last;
+} avr_libgcc_clobbers[] =
+  {
+    { "__clzdi2",      18, 27 },
+    { "__ctzdi2",      18, 27 },
+    { "__ffsdi2",      18, 27 },
+    { "__popcountdi2", 18, 27 },
+    { "__paritydi2",   18, 27 },
+    { "__bswapdi2",    18, 27 }
+  };
 
-  if (set)
-    CLEAR_HARD_REG_SET (*set);
-  count = 0;
 
-  /* No need to save any registers if the function never returns or
-     has the "OS_task" or "OS_main" attribute.  */
+/* Store in *USED the hard registers that CALL_INSN might clobber.  */
 
-  if (TREE_THIS_VOLATILE (current_function_decl)
-      || cfun->machine->is_OS_task
-      || cfun->machine->is_OS_main)
-    return 0;
+static void
+avr_call_insn_clobbers (rtx_insn *call_insn, HARD_REG_SET *used)
+{
+  rtx call = PATTERN (call_insn);
+  rtx addr = NULL_RTX;
+
+  if (GET_CODE (call) == PARALLEL)
+    call = XVECEXP (call, 0, 0);
+  if (GET_CODE (call) == SET)
+    call = SET_SRC (call);
+  if (GET_CODE (call) == CALL
+      && MEM_P (XEXP (call, 0)))
+    addr = XEXP (XEXP (call, 0), 0);
+
+  if (addr && SYMBOL_REF == GET_CODE (addr))
+    for (size_t i = 0; i < ARRAY_SIZE (avr_libgcc_clobbers); i++)
+      if (0 == strcmp (XSTR (addr, 0), avr_libgcc_clobbers[i].name))
+        {
+          CLEAR_HARD_REG_SET (*used);
+          for (int r = avr_libgcc_clobbers[i].first;
+               r <= avr_libgcc_clobbers[i].last; r++)
+            SET_HARD_REG_BIT (*used, r);
+          return;
+        }
 
-  for (reg = 0; reg < 32; reg++)
-    {
-      /* Do not push/pop __tmp_reg__, __zero_reg__, as well as
-         any global register variables.  */
+  get_call_reg_set_usage (call_insn, used, call_used_reg_set);
+}
 
-      if (fixed_regs[reg])
-        continue;
 
-      if ((int_or_sig_p && !crtl->is_leaf && call_used_regs[reg])
-          || (df_regs_ever_live_p (reg)
-              && (int_or_sig_p || !call_used_regs[reg])
-              /* Don't record frame pointer registers here.  They are treated
-                 indivitually in prologue.  */
-              && !(frame_pointer_needed
-                   && (reg == REG_Y || reg == (REG_Y+1)))))
+/* Store in *SET the hard registers that might be clobbered by the calls
+   in the current function.  With -fipa-ra, final records the registers
+   a function uses, see TARGET_CALL_FUSAGE_CONTAINS_NON_CALLEE_CLOBBERS.
+   This is the case for callees in the same TU resp. LTO partition that
+   bind locally, because they are output before their callers.  Calls of
+   libgcc helpers use avr_libgcc_clobbers.  Other calls may clobber all
+   call-used registers.
+
+   The calls don't change from reload on, hence the set is computed only
+   once from then on.  */
+
+static void
+avr_call_clobbered_regs (HARD_REG_SET *set)
+{
+  rtx_insn *insn;
+
+  if (cfun->machine->call_clobbered_regs_valid)
+    {
+      COPY_HARD_REG_SET (*set, cfun->machine->call_clobbered_regs);
+      return;
+    }
+
+  CLEAR_HARD_REG_SET (*set);
+
+  /* We might be called while the prologue is being expanded.  */
+
+  push_topmost_sequence ();
+  insn = get_insns ();
+  pop_topmost_sequence ();
+
+  for (; insn; insn = NEXT_INSN (insn))
+    if (CALL_P (insn))
+      {
+        HARD_REG_SET used;
+
+        avr_call_insn_clobbers (insn, &used);
+        IOR_HARD_REG_SET (*set, used);
+      }
+
+  if (reload_in_progress || reload_completed)
+    {
+      COPY_HARD_REG_SET (cfun->machine->call_clobbered_regs, *set);
+      cfun->machine->call_clobbered_regs_valid = 1;
+    }
+}
+
+
+/* Return the number of hard registers to push/pop in the prologue/epilogue
+   of the current function, and optionally store these registers in SET.  */
+
+static int
+avr_regs_to_save (HARD_REG_SET *set)
+{
+  int reg, count;
+  int int_or_sig_p = cfun->machine->is_interrupt || cfun->machine->is_signal;
+  HARD_REG_SET call_clobbered;
+
+  if (set)
+    CLEAR_HARD_REG_SET (*set);
+  count = 0;
+
+  /* No need to save any registers if the function never returns or
+     has the "OS_task" or "OS_main" attribute.  */
+
+  if (TREE_THIS_VOLATILE (current_function_decl)
+      || cfun->machine->is_OS_task
+      || cfun->machine->is_OS_main)
+    return 0;
+
+  /* A non-leaf ISR must save the call-used registers its callees clobber.  */
+
+  if (int_or_sig_p && !crtl->is_leaf)
+    avr_call_clobbered_regs (&call_clobbered);
+  else
+    CLEAR_HARD_REG_SET (call_clobbered);
+
+  for (reg = 0; reg < 32; reg++)
+    {
+      /* Do not push/pop __tmp_reg__, __zero_reg__, as well as
+         any global register variables.  */
+
+      if (fixed_regs[reg])
+        continue;
+
+      if ((call_used_regs[reg] && TEST_HARD_REG_BIT (call_clobbered, reg))
+          || (df_regs_ever_live_p (reg)
+              && (int_or_sig_p || !call_used_regs[reg])
+              /* Don't record frame pointer registers here.  They are treated
+                 indivitually in prologue.  */
+              && !(frame_pointer_needed
+                   && (reg == REG_Y || reg == (REG_Y+1)))))
         {
           if (set)
             SET_HARD_REG_BIT (*set, reg);
@@ -1609,6 +2141,88 @@ avr_prologue_setup_frame (HOST_WIDE_INT size, HARD_REG_SET set)
 }
 
 
+/* Attach to the "isr_saves" prologue INSN a note that describes the pushes
+   of zero reg and tmp reg as done by avr_out_isr_saves.
+   ??? There's no dwarf2 column reserved for SREG.  */
+
+static void
+avr_isr_saves_frame_note (rtx_insn *insn)
+{
+  int skip = cfun->machine->isr_skip_saves;
+  rtx note = find_reg_note (insn, REG_FRAME_RELATED_EXPR, NULL_RTX);
+  rtx push[2];
+  int n_push = 0;
+
+  if (note)
+    remove_note (insn, note);
+
+  if (!(skip & AVR_ISR_ZERO))
+    push[n_push++] = zero_reg_rtx;
+
+  if (!(skip & AVR_ISR_TMP))
+    push[n_push++] = tmp_reg_rtx;
+
+  for (int i = 0; i < n_push; i++)
+    {
+      rtx mem = gen_rtx_POST_DEC (HImode, stack_pointer_rtx);
+
+      push[i] = gen_rtx_SET (VOIDmode, gen_frame_mem (QImode, mem), push[i]);
+      RTX_FRAME_RELATED_P (push[i]) = 1;
+    }
+
+  RTX_FRAME_RELATED_P (insn) = n_push > 0;
+
+  if (n_push)
+    add_reg_note (insn, REG_FRAME_RELATED_EXPR,
+                  gen_rtx_SEQUENCE (VOIDmode, gen_rtvec_v (n_push, push)));
+}
+
+
+/* Output the "isr_saves" insn:  Save resp. restore zero reg, tmp reg
+   and SREG in the prologue (OP[0] = 1) resp. epilogue (OP[0] = 0) of an
+   ISR except the ones avr_isr_scan_saves found to be unused.
+   PLEN is as for avr_asm_len.  */
+
+const char*
+avr_out_isr_saves (rtx *op, int *plen)
+{
+  int skip = cfun->machine->isr_skip_saves;
+
+  if (plen)
+    *plen = 0;
+
+  if (INTVAL (op[0]))
+    {
+      if (!(skip & AVR_ISR_ZERO))
+        avr_asm_len ("push __zero_reg__", op, plen, 1);
+
+      if (!(skip & AVR_ISR_TMP))
+        avr_asm_len ("push __tmp_reg__", op, plen, 1);
+
+      if (!(skip & AVR_ISR_SREG))
+        avr_asm_len ("in __tmp_reg__,__SREG__" CR_TAB
+                     "push __tmp_reg__", op, plen, 2);
+
+      if (!(skip & AVR_ISR_ZERO))
+        avr_asm_len ("clr __zero_reg__", op, plen, 1);
+    }
+  else
+    {
+      if (!(skip & AVR_ISR_SREG))
+        avr_asm_len ("pop __tmp_reg__" CR_TAB
+                     "out __SREG__,__tmp_reg__", op, plen, 2);
+
+      if (!(skip & AVR_ISR_TMP))
+        avr_asm_len ("pop __tmp_reg__", op, plen, 1);
+
+      if (!(skip & AVR_ISR_ZERO))
+        avr_asm_len ("pop __zero_reg__", op, plen, 1);
+    }
+
+  return "";
+}
+
+
 /*  Output function prologue.  */
 
 void
@@ -1616,6 +2230,7 @@ avr_expand_prologue (void)
 {
   HARD_REG_SET set;
   HOST_WIDE_INT size;
+  rtx_insn *insn;
 
   size = get_frame_size() + avr_outgoing_args_size();
 
@@ -1635,21 +2250,12 @@ avr_expand_prologue (void)
       if (cfun->machine->is_interrupt)
         emit_insn (gen_enable_interrupt ());
 
-      /* Push zero reg.  */
-      emit_push_byte (AVR_ZERO_REGNO, true);
+      /* Push zero reg, tmp reg and SREG, and clear zero reg.  Some of
+         them might be dropped by avr_isr_scan_saves later on.  */
 
-      /* Push tmp reg.  */
-      emit_push_byte (AVR_TMP_REGNO, true);
-
-      /* Push SREG.  */
-      /* ??? There's no dwarf2 column reserved for SREG.  */
-      emit_push_sfr (sreg_rtx, false, false /* clr */);
-
-      /* Clear zero reg.  */
-      emit_move_insn (zero_reg_rtx, const0_rtx);
-
-      /* Prevent any attempt to delete the setting of ZERO_REG!  */
-      emit_use (zero_reg_rtx);
+      insn = emit_insn (gen_isr_saves (const1_rtx));
+      cfun->machine->stack_usage += 3;
+      avr_isr_saves_frame_note (insn);
 
       /* Push and clear RAMPD/X/Y/Z if present and low-part register is used.
          ??? There are no dwarf2 columns reserved for RAMPD/X/Y/Z.  */
@@ -1938,16 +2544,9 @@ avr_expand_epilogue (bool sibcall_p)
           emit_move_insn (rampd_rtx, tmp_reg_rtx);
         }
 
-      /* Restore SREG using tmp_reg as scratch.  */
-
-      emit_pop_byte (AVR_TMP_REGNO);
-      emit_move_insn (sreg_rtx, tmp_reg_rtx);
+      /* Restore SREG using tmp_reg as scratch, tmp reg and zero reg.  */
 
-      /* Restore tmp REG.  */
-      emit_pop_byte (AVR_TMP_REGNO);
-
-      /* Restore zero REG.  */
-      emit_pop_byte (AVR_ZERO_REGNO);
+      emit_insn (gen_isr_saves (const0_rtx));
     }
 
   if (!sibcall_p)
@@ -5868,6 +6467,205 @@ avr_out_tstsi (rtx_insn *insn, rtx *op, int *plen)
 }
 
 
+/* Helper for out_shift_with_cnt:  Print a shift of OP[0] by the variable
+   offset in QImode register OP[3] that takes the same number of cycles
+   for every offset.  The shift is determined by the SET_SRC of INSN;
+   TEMPL and T_LEN are as for out_shift_with_cnt.  PLEN is as for
+   avr_asm_len.
+
+   Bits 4 and 3 of the offset move whole bytes:  Each byte move is a
+   single instruction guarded by SBRC.  The remaining offset M in 0...7
+   is performed by an IJMP into an unrolled ladder of 7 one-bit shifts so
+   that exactly M of them are executed.  A second IJMP into a sled of NOPs
+   resp. "rjmp .+0" makes up for the 7 - M shifts that have been skipped.
+   Z is saved around the sequence if it is live after INSN.  */
+
+static void
+avr_out_shift_ladder (const char *templ, rtx_insn *insn, rtx *op,
+                      int *plen, int t_len)
+{
+  enum rtx_code code = GET_CODE (SET_SRC (single_set (insn)));
+  int n_bytes = GET_MODE_SIZE (GET_MODE (op[0]));
+  int reg0 = REGNO (op[0]);
+  bool save_z = (!reg_unused_after (insn, all_regs_rtx[REG_Z])
+                 || !reg_unused_after (insn, all_regs_rtx[REG_Z + 1]));
+  bool sled_rjmp = t_len % 2 == 0;
+  rtx xop[4];
+  int bit, i;
+
+  xop[0] = op[3];
+
+  if (save_z)
+    avr_asm_len ("push r30" CR_TAB
+                 "push r31", xop, plen, 2);
+
+  for (bit = 4; bit >= 3; bit--)
+    {
+      int n_move = 1 << (bit - 3);
+
+      if (n_move >= n_bytes)
+        continue;
+
+      xop[1] = GEN_INT (bit);
+
+      if (ASHIFT == code)
+        {
+          for (i = n_bytes - 1; i >= 0; i--)
+            {
+              xop[2] = all_regs_rtx[reg0 + i];
+
+              if (i >= n_move)
+                {
+                  xop[3] = all_regs_rtx[reg0 + i - n_move];
+                  avr_asm_len ("sbrc %0,%1" CR_TAB
+                               "mov %2,%3", xop, plen, 2);
+                }
+              else
+                avr_asm_len ("sbrc %0,%1" CR_TAB
+                             "clr %2", xop, plen, 2);
+            }
+          continue;
+        }
+
+      for (i = 0; i < n_bytes - n_move; i++)
+        {
+          xop[2] = all_regs_rtx[reg0 + i];
+          xop[3] = all_regs_rtx[reg0 + i + n_move];
+          avr_asm_len ("sbrc %0,%1" CR_TAB
+                       "mov %2,%3", xop, plen, 2);
+        }
+
+      if (LSHIFTRT == code)
+        {
+          for (; i < n_bytes; i++)
+            {
+              xop[2] = all_regs_rtx[reg0 + i];
+              avr_asm_len ("sbrc %0,%1" CR_TAB
+                           "clr %2", xop, plen, 2);
+            }
+          continue;
+        }
+
+      /* ASHIFTRT:  Fill the vacated bytes with the sign.  */
+
+      xop[3] = all_regs_rtx[reg0 + n_bytes - 1];
+      avr_asm_len ("sbrc %0,%1" CR_TAB "lsl %3" CR_TAB
+                   "sbrc %0,%1" CR_TAB "sbc %3,%3", xop, plen, 4);
+
+      for (; i < n_bytes - 1; i++)
+        {
+          xop[2] = all_regs_rtx[reg0 + i];
+          avr_asm_len ("sbrc %0,%1" CR_TAB
+                       "mov %2,%3", xop, plen, 2);
+        }
+    }
+
+  /* R31 = (7 - M) * T_LEN is the number of ladder words to skip.  Keep
+     a copy in __tmp_reg__ for the sled.  */
+
+  avr_asm_len ("mov r31,%0" CR_TAB
+               "com r31"    CR_TAB
+               "andi r31,7", xop, plen, 3);
+
+  if (t_len == 2)
+    avr_asm_len ("lsl r31", xop, plen, 1);
+  else if (t_len == 3)
+    avr_asm_len ("mov r30,r31" CR_TAB
+                 "lsl r31"     CR_TAB
+                 "add r31,r30", xop, plen, 3);
+  else if (t_len == 4)
+    avr_asm_len ("lsl r31" CR_TAB
+                 "lsl r31", xop, plen, 2);
+
+  avr_asm_len ("mov __tmp_reg__,r31"    CR_TAB
+               "ldi r30,lo8(gs(3f))"    CR_TAB
+               "add r30,r31"            CR_TAB
+               "ldi r31,hi8(gs(3f))"    CR_TAB
+               "adc r31,__zero_reg__"   CR_TAB
+               "ijmp"                   CR_TAB
+               "3:", xop, plen, 6);
+
+  for (i = 0; i < 7; i++)
+    avr_asm_len (templ, op, plen, t_len);
+
+  /* Pad with (7 - M) * T_LEN cycles.  */
+
+  xop[1] = GEN_INT (7 * t_len);
+  avr_asm_len ("ldi r31,%1" CR_TAB
+               "sub r31,__tmp_reg__", xop, plen, 2);
+
+  if (sled_rjmp)
+    avr_asm_len ("lsr r31", xop, plen, 1);
+
+  avr_asm_len ("ldi r30,lo8(gs(4f))"    CR_TAB
+               "add r30,r31"            CR_TAB
+               "ldi r31,hi8(gs(4f))"    CR_TAB
+               "adc r31,__zero_reg__"   CR_TAB
+               "ijmp"                   CR_TAB
+               "4:", xop, plen, 5);
+
+  for (i = 0; i < (sled_rjmp ? 7 * t_len / 2 : 7 * t_len); i++)
+    avr_asm_len (sled_rjmp ? "rjmp .+0" : "nop", xop, plen, 1);
+
+  if (save_z)
+    avr_asm_len ("pop r31" CR_TAB
+                 "pop r30", xop, plen, 2);
+}
+
+
+/* Return true if out_shift_with_cnt shall print the shift by the variable
+   offset OP[3] of INSN by means of avr_out_shift_ladder instead of a
+   loop.  OP[3] must hold the offset itself, which is not the case for
+   constant offsets.  This depends on -mshift-ladder=:  With "auto", the
+   ladder is used in functions optimized for speed if it takes fewer
+   cycles than the loop needs for an average offset of half the bits of
+   the mode.  */
+
+static bool
+avr_shift_ladder_p (const char *templ, rtx_insn *insn, rtx *op, int t_len)
+{
+  int n_bits, len = 0, sled, cycles_ladder, cycles_loop;
+  rtx set = single_set (insn);
+
+  if (AVR_SHIFT_LADDER_LOOP == avr_shift_ladder
+      /* IJMP cannot reach code beyond 128 KiB, and the offsets are
+         computed in the low 64 KiW of the gs() stubs.  */
+      || AVR_3_BYTE_PC
+      || !set
+      || !REG_P (op[0])
+      || !REG_P (op[3])
+      || reg_overlap_mentioned_p (op[0], all_regs_rtx[REG_Z])
+      || reg_overlap_mentioned_p (op[0], all_regs_rtx[REG_Z + 1])
+      || reg_overlap_mentioned_p (op[0], op[3]))
+    return false;
+
+  if (AVR_SHIFT_LADDER_ALWAYS == avr_shift_ladder)
+    return true;
+
+  if (!optimize_function_for_speed_p (cfun))
+    return false;
+
+  /* All instructions of the ladder are executed once and take one cycle,
+     except for the ladder and sled which take 7 * T_LEN cycles together,
+     the two IJMPs and PUSH / POP.  */
+
+  avr_out_shift_ladder (templ, insn, op, &len, t_len);
+
+  sled = t_len % 2 == 0 ? 7 * t_len / 2 : 7 * t_len;
+  cycles_ladder = len - sled + 2;
+  if (!reg_unused_after (insn, all_regs_rtx[REG_Z])
+      || !reg_unused_after (insn, all_regs_rtx[REG_Z + 1]))
+    cycles_ladder += 4;
+
+  /* The loop:  RJMP, then T_LEN + DEC + BRPL per bit.  */
+
+  n_bits = GET_MODE_BITSIZE (GET_MODE (SET_DEST (set)));
+  cycles_loop = 3 + (n_bits / 2) * (t_len + 3);
+
+  return cycles_ladder < cycles_loop;
+}
+
+
 /* Generate asm equivalent for various shifts.  This only handles cases
    that are not already carefully hand-optimized in ?sh??i3_out.
 
@@ -5974,6 +6772,16 @@ out_shift_with_cnt (const char *templ, rtx_insn *insn, rtx operands[],
   else
     fatal_insn ("bad shift insn:", insn);
 
+  /* Constant offsets have been loaded to a counter above that might be
+     __zero_reg__ with one bit set, or a register saved in __tmp_reg__.  */
+
+  if (!CONST_INT_P (operands[2])
+      && avr_shift_ladder_p (templ, insn, op, t_len))
+    {
+      avr_out_shift_ladder (templ, insn, op, plen, t_len);
+      return;
+    }
+
   if (second_label)
       avr_asm_len ("rjmp 2f", op, plen, 1);
 
@@ -7384,88 +8192,565 @@ lshrsi3_out (rtx_insn *insn, rtx operands[], int *len)
 }
 
 
-/* Output addition of register XOP[0] and compile time constant XOP[2].
-   CODE == PLUS:  perform addition by using ADD instructions or
-   CODE == MINUS: perform addition by using SUB instructions:
-
-      XOP[0] = XOP[0] + XOP[2]
-
-   Or perform addition/subtraction with register XOP[2] depending on CODE:
-
-      XOP[0] = XOP[0] +/- XOP[2]
-
-   If PLEN == NULL, print assembler instructions to perform the operation;
-   otherwise, set *PLEN to the length of the instruction sequence (in words)
-   printed with PLEN == NULL.  XOP[3] is an 8-bit scratch register or NULL_RTX.
-   Set *PCC to effect on cc0 according to respective CC_* insn attribute.
-
-   CODE_SAT == UNKNOWN: Perform ordinary, non-saturating operation.
-   CODE_SAT != UNKNOWN: Perform operation and saturate according to CODE_SAT.
-   If  CODE_SAT != UNKNOWN  then SIGN contains the sign of the summand resp.
-   the subtrahend in the original insn, provided it is a compile time constant.
-   In all other cases, SIGN is 0.
-
-   If OUT_LABEL is true, print the final 0: label which is needed for
-   saturated addition / subtraction.  The only case where OUT_LABEL = false
-   is useful is for saturated addition / subtraction performed during
-   fixed-point rounding, cf. `avr_out_round'.  */
+/* Print one single-bit step of a DImode shift of ACC_A = R25:R18 in the
+   way of CODE.  Only bytes LO...HI take part, the others are known to be
+   zero resp. the sign.  ROTATERT is used to implement rotations by more
+   than 4 bits.  */
 
 static void
-avr_out_plus_1 (rtx *xop, int *plen, enum rtx_code code, int *pcc,
-                enum rtx_code code_sat, int sign, bool out_label)
+avr_out_shift64_step (enum rtx_code code, int lo, int hi, int *plen)
 {
-  /* MODE of the operation.  */
-  machine_mode mode = GET_MODE (xop[0]);
+  rtx xop[2];
+  int i;
 
-  /* INT_MODE of the same size.  */
-  machine_mode imode = int_mode_for_mode (mode);
+  xop[0] = all_regs_rtx[18 + lo];
+  xop[1] = all_regs_rtx[18 + hi];
 
-  /* Number of bytes to operate on.  */
-  int i, n_bytes = GET_MODE_SIZE (mode);
+  switch (code)
+    {
+    case ASHIFT:
+    case ROTATE:
+      avr_asm_len ("lsl %0", xop, plen, 1);
+      for (i = lo + 1; i <= hi; i++)
+        avr_asm_len ("rol %0", &all_regs_rtx[18 + i], plen, 1);
+      if (ROTATE == code)
+        avr_asm_len ("adc %0,__zero_reg__", xop, plen, 1);
+      break;
 
-  /* Value (0..0xff) held in clobber register op[3] or -1 if unknown.  */
-  int clobber_val = -1;
+    case ROTATERT:
+      avr_asm_len ("bst %0,0", xop, plen, 1);
+      /* FALLTHRU */
 
-  /* op[0]: 8-bit destination register
-     op[1]: 8-bit const int
-     op[2]: 8-bit scratch register */
-  rtx op[3];
+    case LSHIFTRT:
+    case ASHIFTRT:
+      avr_asm_len (ASHIFTRT == code ? "asr %1" : "lsr %1", xop, plen, 1);
+      for (i = hi - 1; i >= lo; i--)
+        avr_asm_len ("ror %0", &all_regs_rtx[18 + i], plen, 1);
+      if (ROTATERT == code)
+        avr_asm_len ("bld %1,7", xop, plen, 1);
+      break;
 
-  /* Started the operation?  Before starting the operation we may skip
-     adding 0.  This is no more true after the operation started because
-     carry must be taken into account.  */
-  bool started = false;
+    default:
+      gcc_unreachable ();
+    }
+}
 
-  /* Value to add.  There are two ways to add VAL: R += VAL and R -= -VAL.  */
-  rtx xval = xop[2];
 
-  /* Output a BRVC instruction.  Only needed with saturation.  */
-  bool out_brvc = true;
+/* Worker for avr_out_shift64 and avr_shift64_inline_p:  Print resp.
+   measure a DImode shift of ACC_A by the constant COUNT as of CODE.
+   Whole bytes are moved first, the remaining bits are shifted one at a
+   time, unrolled or in a loop counted by R16.  SPEED: Unroll more.  */
+
+static void
+avr_out_shift64_1 (enum rtx_code code, int count, bool speed, int *plen)
+{
+  int k = (count & 63) / 8, m = count & 7;
+  int lo = 0, hi = 7, i, t_len;
+  rtx xop[2];
 
   if (plen)
     *plen = 0;
 
-  if (REG_P (xop[2]))
+  if (ROTATE == code)
     {
-      *pcc = MINUS == code ? (int) CC_SET_CZN : (int) CC_CLOBBER;
+      /* Rotate by more than 4 bits as one more byte to the left and the
+         rest to the right.  */
 
-      for (i = 0; i < n_bytes; i++)
+      if (m > 4)
         {
-          /* We operate byte-wise on the destination.  */
-          op[0] = simplify_gen_subreg (QImode, xop[0], mode, i);
-          op[1] = simplify_gen_subreg (QImode, xop[2], mode, i);
-
-          if (i == 0)
-            avr_asm_len (code == PLUS ? "add %0,%1" : "sub %0,%1",
-                         op, plen, 1);
-          else
-            avr_asm_len (code == PLUS ? "adc %0,%1" : "sbc %0,%1",
-                         op, plen, 1);
+          k = (k + 1) % 8;
+          m = 8 - m;
+          code = ROTATERT;
         }
 
-      if (reg_overlap_mentioned_p (xop[0], xop[2]))
+      /* Permute the bytes cycle by cycle, using __tmp_reg__ to close each
+         cycle.  There are gcd (8, K) = K & -K cycles.  */
+
+      for (i = 0; k && i < (k & -k); i++)
         {
-          gcc_assert (REGNO (xop[0]) == REGNO (xop[2]));
+          int j = i;
+
+          xop[0] = all_regs_rtx[18 + i];
+          avr_asm_len ("mov __tmp_reg__,%0", xop, plen, 1);
+
+          for (;;)
+            {
+              int src = (j - k) & 7;
+
+              xop[0] = all_regs_rtx[18 + j];
+              xop[1] = src == i ? tmp_reg_rtx : all_regs_rtx[18 + src];
+              avr_asm_len ("mov %0,%1", xop, plen, 1);
+
+              if (src == i)
+                break;
+              j = src;
+            }
+        }
+    }
+  else if (ASHIFT == code)
+    {
+      for (i = 7; k && i >= k; i--)
+        {
+          if (k % 2 == 0 && i % 2 == 1 && i - 1 >= k)
+            {
+              xop[0] = all_regs_rtx[18 + i - 1];
+              xop[1] = all_regs_rtx[18 + i - 1 - k];
+              avr_asm_len ("movw %0,%1", xop, plen, 1);
+              i--;
+            }
+          else
+            {
+              xop[0] = all_regs_rtx[18 + i];
+              xop[1] = all_regs_rtx[18 + i - k];
+              avr_asm_len ("mov %0,%1", xop, plen, 1);
+            }
+        }
+
+      for (i = 0; i < k; i++)
+        avr_asm_len ("clr %0", &all_regs_rtx[18 + i], plen, 1);
+
+      lo = k;
+    }
+  else
+    {
+      for (i = 0; k && i <= 7 - k; i++)
+        {
+          if (k % 2 == 0 && i % 2 == 0 && i + 1 <= 7 - k)
+            {
+              xop[0] = all_regs_rtx[18 + i];
+              xop[1] = all_regs_rtx[18 + i + k];
+              avr_asm_len ("movw %0,%1", xop, plen, 1);
+              i++;
+            }
+          else
+            {
+              xop[0] = all_regs_rtx[18 + i];
+              xop[1] = all_regs_rtx[18 + i + k];
+              avr_asm_len ("mov %0,%1", xop, plen, 1);
+            }
+        }
+
+      if (k && LSHIFTRT == code)
+        {
+          for (i = 8 - k; i <= 7; i++)
+            avr_asm_len ("clr %0", &all_regs_rtx[18 + i], plen, 1);
+        }
+      else if (k)
+        {
+          /* R25 still holds the original high byte:  Fill with its sign.  */
+
+          xop[0] = all_regs_rtx[18 + 7];
+          avr_asm_len ("lsl %0" CR_TAB
+                       "sbc %0,%0", xop, plen, 2);
+
+          for (i = 8 - k; i < 7; i++)
+            {
+              xop[1] = all_regs_rtx[18 + i];
+              avr_asm_len ("mov %1,%0", xop, plen, 1);
+            }
+        }
+
+      hi = 7 - k;
+    }
+
+  if (m == 0)
+    return;
+
+  /* Single-bit shifts.  */
+
+  t_len = hi - lo + 1 + (ROTATE == code) + 2 * (ROTATERT == code);
+
+  if (m * t_len <= t_len + 3
+      || (speed && m * t_len <= 40))
+    {
+      for (i = 0; i < m; i++)
+        avr_out_shift64_step (code, lo, hi, plen);
+    }
+  else
+    {
+      xop[0] = GEN_INT (m);
+      avr_asm_len ("ldi r16,%0" CR_TAB
+                   "1:", xop, plen, 1);
+      avr_out_shift64_step (code, lo, hi, plen);
+      avr_asm_len ("dec r16" CR_TAB
+                   "brne 1b", xop, plen, 2);
+    }
+}
+
+
+/* Print a DImode shift resp. rotation of ACC_A by the constant OP[0] as
+   of "<code_stdname><mode>3_const_insn".  PLEN is as for avr_asm_len.  */
+
+const char*
+avr_out_shift64 (rtx_insn *insn, rtx *op, int *plen)
+{
+  enum rtx_code code = GET_CODE (SET_SRC (single_set (insn)));
+
+  avr_out_shift64_1 (code, INTVAL (op[0]),
+                     optimize_function_for_speed_p (cfun), plen);
+
+  return "";
+}
+
+
+/* Return true if a DImode shift CODE by COUNT shall be expanded inline
+   instead of calling libgcc's __<code_stdname>di3.  This is always the
+   case for constant offsets when optimizing for speed; otherwise the
+   inline code must not be longer than loading R16 and the call.  */
+
+bool
+avr_shift64_inline_p (enum rtx_code code, rtx count)
+{
+  int len;
+
+  if (!CONST_INT_P (count))
+    return false;
+
+  if (optimize_function_for_speed_p (cfun))
+    return true;
+
+  avr_out_shift64_1 (code, INTVAL (count), false, &len);
+
+  return len <= 1 + (AVR_HAVE_JMP_CALL ? 2 : 1);
+}
+
+
+/* Print the lower N_BYTES bytes of the product R13:R10 * R17:R14 to
+   R18...  The partial products are summed up column by column.  A column
+   together with the carry from the previous one fits in 3 bytes, so adding
+   a product never carries out of the third byte of its column.  For signed
+   factors, the unsigned product is fixed by subtracting the other factor
+   from the high part if a factor is negative.  R26 serves as zero register
+   because MUL clobbers R1.  PLEN is as for avr_asm_len.  */
+
+static void
+avr_out_mul32x32 (bool signed_p, int n_bytes, int *plen)
+{
+  rtx xop[5];
+  int col, i, b;
+
+  avr_asm_len ("clr r20" CR_TAB
+               "clr r21", xop, plen, 2);
+
+  for (b = 22; b < 18 + n_bytes; b += 2)
+    {
+      xop[0] = all_regs_rtx[b];
+      avr_asm_len ("movw %0,r20", xop, plen, 1);
+    }
+
+  avr_asm_len ("clr r26"       CR_TAB
+               "mul r10,r14"   CR_TAB
+               "movw r18,r0", xop, plen, 3);
+
+  for (col = 1; col <= 6 && col < n_bytes; col++)
+    for (i = 0; i <= 3; i++)
+      {
+        int j = col - i;
+
+        if (j < 0 || j > 3)
+          continue;
+
+        xop[0] = all_regs_rtx[10 + i];
+        xop[1] = all_regs_rtx[14 + j];
+        xop[2] = all_regs_rtx[18 + col];
+
+        avr_asm_len ("mul %0,%1" CR_TAB
+                     "add %2,r0", xop, plen, 2);
+
+        if (col + 1 < n_bytes)
+          {
+            xop[3] = all_regs_rtx[18 + col + 1];
+            avr_asm_len ("adc %3,r1", xop, plen, 1);
+          }
+
+        if (col + 2 < n_bytes)
+          {
+            xop[4] = all_regs_rtx[18 + col + 2];
+            avr_asm_len ("adc %4,r26", xop, plen, 1);
+          }
+      }
+
+  avr_asm_len ("clr __zero_reg__", xop, plen, 1);
+
+  if (signed_p)
+    {
+      avr_asm_len ("sbrs r13,7" CR_TAB
+                   "rjmp 1f", xop, plen, 2);
+
+      for (b = 4; b < n_bytes; b++)
+        {
+          xop[0] = all_regs_rtx[18 + b];
+          xop[1] = all_regs_rtx[14 + b - 4];
+          avr_asm_len (b == 4 ? "sub %0,%1" : "sbc %0,%1", xop, plen, 1);
+        }
+
+      avr_asm_len ("1:"         CR_TAB
+                   "sbrs r17,7" CR_TAB
+                   "rjmp 2f", xop, plen, 2);
+
+      for (b = 4; b < n_bytes; b++)
+        {
+          xop[0] = all_regs_rtx[18 + b];
+          xop[1] = all_regs_rtx[10 + b - 4];
+          avr_asm_len (b == 4 ? "sub %0,%1" : "sbc %0,%1", xop, plen, 1);
+        }
+
+      avr_asm_len ("2:", xop, plen, 0);
+    }
+}
+
+
+/* Print the inline 32 x 32 -> 64 bit multiplication "mulsidi3_inline_insn"
+   resp. "umulsidi3_inline_insn":  R25:R18 = R13:R10 * R17:R14.  The same
+   serves "<extend_su>mulsi3_highpart_inline_insn" which only uses the high
+   part R25:R22.  PLEN is as for avr_asm_len.  */
+
+const char*
+avr_out_mulsidi3 (rtx_insn *insn, rtx *op ATTRIBUTE_UNUSED, int *plen)
+{
+  rtx src = SET_SRC (single_set (insn));
+
+  if (TRUNCATE == GET_CODE (src))
+    src = XEXP (XEXP (src, 0), 0);
+
+  if (plen)
+    *plen = 0;
+
+  avr_out_mul32x32 (SIGN_EXTEND == GET_CODE (XEXP (src, 0)), 8, plen);
+
+  return "";
+}
+
+
+/* Print the inline fixed-point multiplications "mul<mode>3_inline" for
+   HQ, UHQ, HA and UHA, and "mul<mode>3_inline_insn" for SA and USA.
+   The result consists of the bits FBIT... of the integer product P of the
+   factors, rounded by means of bit FBIT-1 just like libgcc's __mul<mode>3
+   does.  Signed products are computed as unsigned products and then fixed
+   up like in avr_out_mul32x32.  The only overflow of the non-saturating
+   HQ multiplication is -1 * -1 which yields 1 - 2^-15 like in libgcc.
+
+   16-bit modes:  OP[0] = OP[1] * OP[2] with 8-bit scratch OP[3] for the
+   bits below the result.  32-bit modes:  R23:R20 = R13:R10 * R17:R14.
+   PLEN is as for avr_asm_len.  */
+
+const char*
+avr_out_mul_fixed (rtx_insn *insn, rtx *op, int *plen)
+{
+  machine_mode mode = GET_MODE (SET_DEST (single_set (insn)));
+  int fbit = GET_MODE_FBIT (mode);
+  bool signed_p = !UNSIGNED_FIXED_POINT_MODE_P (mode);
+  rtx xop[7];
+
+  if (plen)
+    *plen = 0;
+
+  if (GET_MODE_SIZE (mode) == 4)
+    {
+      /* Bytes 1...5 of P are all we need.  */
+
+      avr_out_mul32x32 (signed_p, 6, plen);
+
+      if (fbit == 15)
+        avr_asm_len ("lsl r19" CR_TAB
+                     "rol r20" CR_TAB
+                     "rol r21" CR_TAB
+                     "rol r22" CR_TAB
+                     "rol r23", xop, plen, 5);
+
+      return avr_asm_len ("lsl r19"              CR_TAB
+                          "adc r20,__zero_reg__" CR_TAB
+                          "adc r21,__zero_reg__" CR_TAB
+                          "adc r22,__zero_reg__" CR_TAB
+                          "adc r23,__zero_reg__", xop, plen, 5);
+    }
+
+  xop[0] = simplify_gen_subreg (QImode, op[0], mode, 0);
+  xop[1] = simplify_gen_subreg (QImode, op[0], mode, 1);
+  xop[2] = simplify_gen_subreg (QImode, op[1], mode, 0);
+  xop[3] = simplify_gen_subreg (QImode, op[1], mode, 1);
+  xop[4] = simplify_gen_subreg (QImode, op[2], mode, 0);
+  xop[5] = simplify_gen_subreg (QImode, op[2], mode, 1);
+  xop[6] = op[3];
+
+  switch (fbit)
+    {
+    case 8:
+      /* UHA:  The result is bytes 1...2 of P.  The high byte of the
+         lowest partial product is at most 0xfe, hence rounding it up
+         cannot carry.  */
+
+      return avr_asm_len ("mul %2,%4"  CR_TAB
+                          "mov %0,r1"  CR_TAB
+                          "sbrc r0,7"  CR_TAB
+                          "inc %0"     CR_TAB
+                          "mul %3,%5"  CR_TAB
+                          "mov %1,r0"  CR_TAB
+                          "mul %3,%4"  CR_TAB
+                          "add %0,r0"  CR_TAB
+                          "adc %1,r1"  CR_TAB
+                          "mul %2,%5"  CR_TAB
+                          "add %0,r0"  CR_TAB
+                          "adc %1,r1"  CR_TAB
+                          "clr __zero_reg__", xop, plen, 13);
+
+    case 7:
+      /* HA:  The result is bytes 1...2 of 2 * P.  Bytes 0...2 of P are
+         computed in %6, %1:%0.  The sign only affects byte 2.  */
+
+      avr_asm_len ("mul %2,%4"  CR_TAB
+                   "mov %6,r0"  CR_TAB
+                   "mov %0,r1"  CR_TAB
+                   "mul %3,%5"  CR_TAB
+                   "mov %1,r0"  CR_TAB
+                   "mul %3,%4"  CR_TAB
+                   "add %0,r0"  CR_TAB
+                   "adc %1,r1"  CR_TAB
+                   "mul %2,%5"  CR_TAB
+                   "add %0,r0"  CR_TAB
+                   "adc %1,r1"  CR_TAB
+                   "clr __zero_reg__" CR_TAB
+                   "sbrc %3,7"  CR_TAB
+                   "sub %1,%4"  CR_TAB
+                   "sbrc %5,7"  CR_TAB
+                   "sub %1,%2"  CR_TAB
+                   "lsl %6"     CR_TAB
+                   "rol %0"     CR_TAB
+                   "rol %1", xop, plen, 19);
+      break;
+
+    case 15:
+    case 16:
+      /* HQ resp. UHQ:  The result is bytes 2...3 of 2 * P resp. P.
+         Bytes 1...3 of P are computed in %6, %1:%0.  */
+
+      avr_asm_len ("mul %2,%4"  CR_TAB
+                   "mov %6,r1"  CR_TAB
+                   "mul %3,%5"  CR_TAB
+                   "movw %0,r0" CR_TAB
+                   "mul %3,%4"  CR_TAB
+                   "add %6,r0"  CR_TAB
+                   "adc %0,r1"  CR_TAB
+                   "clr __zero_reg__"     CR_TAB
+                   "adc %1,__zero_reg__"  CR_TAB
+                   "mul %2,%5"  CR_TAB
+                   "add %6,r0"  CR_TAB
+                   "adc %0,r1"  CR_TAB
+                   "clr __zero_reg__"     CR_TAB
+                   "adc %1,__zero_reg__", xop, plen, 14);
+
+      if (signed_p)
+        avr_asm_len ("sbrc %3,7"  CR_TAB
+                     "sub %0,%4"  CR_TAB
+                     "sbrc %3,7"  CR_TAB
+                     "sbc %1,%5"  CR_TAB
+                     "sbrc %5,7"  CR_TAB
+                     "sub %0,%2"  CR_TAB
+                     "sbrc %5,7"  CR_TAB
+                     "sbc %1,%3"  CR_TAB
+                     "lsl %6"     CR_TAB
+                     "rol %0"     CR_TAB
+                     "rol %1"     CR_TAB
+                     "brvc 0f"    CR_TAB
+                     "com %0"     CR_TAB
+                     "dec %1"     CR_TAB
+                     "0:", xop, plen, 14);
+      break;
+
+    default:
+      gcc_unreachable ();
+    }
+
+  /* Round.  */
+
+  return avr_asm_len ("lsl %6"               CR_TAB
+                      "adc %0,__zero_reg__"  CR_TAB
+                      "adc %1,__zero_reg__", xop, plen, 3);
+}
+
+
+/* Output addition of register XOP[0] and compile time constant XOP[2].
+   CODE == PLUS:  perform addition by using ADD instructions or
+   CODE == MINUS: perform addition by using SUB instructions:
+
+      XOP[0] = XOP[0] + XOP[2]
+
+   Or perform addition/subtraction with register XOP[2] depending on CODE:
+
+      XOP[0] = XOP[0] +/- XOP[2]
+
+   If PLEN == NULL, print assembler instructions to perform the operation;
+   otherwise, set *PLEN to the length of the instruction sequence (in words)
+   printed with PLEN == NULL.  XOP[3] is an 8-bit scratch register or NULL_RTX.
+   Set *PCC to effect on cc0 according to respective CC_* insn attribute.
+
+   CODE_SAT == UNKNOWN: Perform ordinary, non-saturating operation.
+   CODE_SAT != UNKNOWN: Perform operation and saturate according to CODE_SAT.
+   If  CODE_SAT != UNKNOWN  then SIGN contains the sign of the summand resp.
+   the subtrahend in the original insn, provided it is a compile time constant.
+   In all other cases, SIGN is 0.
+
+   If OUT_LABEL is true, print the final 0: label which is needed for
+   saturated addition / subtraction.  The only case where OUT_LABEL = false
+   is useful is for saturated addition / subtraction performed during
+   fixed-point rounding, cf. `avr_out_round'.  */
+
+static void
+avr_out_plus_1 (rtx *xop, int *plen, enum rtx_code code, int *pcc,
+                enum rtx_code code_sat, int sign, bool out_label)
+{
+  /* MODE of the operation.  */
+  machine_mode mode = GET_MODE (xop[0]);
+
+  /* INT_MODE of the same size.  */
+  machine_mode imode = int_mode_for_mode (mode);
+
+  /* Number of bytes to operate on.  */
+  int i, n_bytes = GET_MODE_SIZE (mode);
+
+  /* Value (0..0xff) held in clobber register op[3] or -1 if unknown.  */
+  int clobber_val = -1;
+
+  /* op[0]: 8-bit destination register
+     op[1]: 8-bit const int
+     op[2]: 8-bit scratch register */
+  rtx op[3];
+
+  /* Started the operation?  Before starting the operation we may skip
+     adding 0.  This is no more true after the operation started because
+     carry must be taken into account.  */
+  bool started = false;
+
+  /* Value to add.  There are two ways to add VAL: R += VAL and R -= -VAL.  */
+  rtx xval = xop[2];
+
+  /* Output a BRVC instruction.  Only needed with saturation.  */
+  bool out_brvc = true;
+
+  if (plen)
+    *plen = 0;
+
+  if (REG_P (xop[2]))
+    {
+      *pcc = MINUS == code ? (int) CC_SET_CZN : (int) CC_CLOBBER;
+
+      for (i = 0; i < n_bytes; i++)
+        {
+          /* We operate byte-wise on the destination.  */
+          op[0] = simplify_gen_subreg (QImode, xop[0], mode, i);
+          op[1] = simplify_gen_subreg (QImode, xop[2], mode, i);
+
+          if (i == 0)
+            avr_asm_len (code == PLUS ? "add %0,%1" : "sub %0,%1",
+                         op, plen, 1);
+          else
+            avr_asm_len (code == PLUS ? "adc %0,%1" : "sbc %0,%1",
+                         op, plen, 1);
+        }
+
+      if (reg_overlap_mentioned_p (xop[0], xop[2]))
+        {
+          gcc_assert (REGNO (xop[0]) == REGNO (xop[2]));
 
           if (MINUS == code)
             return;
@@ -8789,35 +10074,292 @@ avr_out_fract (rtx_insn *insn, rtx operands[], bool intsigned, int *plen)
 }
 
 
-/* Output fixed-point rounding.  XOP[0] = XOP[1] is the operand to round.
-   XOP[2] is the rounding point, a CONST_INT.  The function prints the
-   instruction sequence if PLEN = NULL and computes the length in words
-   of the sequence if PLEN != NULL.  Most of this function deals with
-   preparing operands for calls to `avr_out_plus' and `avr_out_bitop'.  */
+/* Output saturated negation resp. absolute value "ss<abs|neg><mode>2" of
+   signed fixed-point and integer modes:  OP[0] = OP[1] is the operand.
+   The negation is  ~X + 1  computed by COM and SBCI, hence V is set after
+   the last SBCI iff X is the most negative value.  That value saturates
+   to the largest one which is just one less.  PLEN is as for
+   avr_asm_len.  */
 
 const char*
-avr_out_round (rtx_insn *insn ATTRIBUTE_UNUSED, rtx *xop, int *plen)
+avr_out_ss_abs_neg (rtx_insn *insn, rtx *op, int *plen)
 {
-  machine_mode mode = GET_MODE (xop[0]);
-  machine_mode imode = int_mode_for_mode (mode);
-  // The smallest fractional bit not cleared by the rounding is 2^(-RP).
-  int fbit = (int) GET_MODE_FBIT (mode);
-  double_int i_add = double_int_zero.set_bit (fbit-1 - INTVAL (xop[2]));
-  wide_int wi_add = wi::set_bit_in_zero (fbit-1 - INTVAL (xop[2]),
-					 GET_MODE_PRECISION (imode));
-  // Lengths of PLUS and AND parts.
-  int len_add = 0, *plen_add = plen ? &len_add : NULL;
-  int len_and = 0, *plen_and = plen ? &len_and : NULL;
+  enum rtx_code code = GET_CODE (SET_SRC (single_set (insn)));
+  machine_mode mode = GET_MODE (op[0]);
+  int i, n_bytes = GET_MODE_SIZE (mode);
+  rtx xop[1];
+
+  if (n_bytes == 1)
+    return SS_ABS == code
+      ? avr_asm_len ("sbrc %0,7" CR_TAB
+                     "neg %0"    CR_TAB
+                     "sbrc %0,7" CR_TAB
+                     "dec %0", op, plen, -4)
+      : avr_asm_len ("neg %0"    CR_TAB
+                     "brvc 0f"   CR_TAB
+                     "dec %0"    CR_TAB
+                     "0:", op, plen, -3);
 
-  // Add-Saturate  1/2 * 2^(-RP).  Don't print the label "0:" when printing
-  // the saturated addition so that we can emit the "rjmp 1f" before the
-  // "0:" below.
+  if (plen)
+    *plen = 0;
 
-  rtx xadd = const_fixed_from_double_int (i_add, mode);
-  rtx xpattern, xsrc, op[4];
+  if (SS_ABS == code)
+    {
+      xop[0] = simplify_gen_subreg (QImode, op[0], mode, n_bytes - 1);
+      avr_asm_len ("sbrs %0,7" CR_TAB
+                   "rjmp 0f", xop, plen, 2);
+    }
 
-  xsrc = SIGNED_FIXED_POINT_MODE_P (mode)
-    ? gen_rtx_SS_PLUS (mode, xop[1], xadd)
+  for (i = 1; i < n_bytes; i++)
+    {
+      xop[0] = simplify_gen_subreg (QImode, op[0], mode, i);
+      avr_asm_len ("com %0", xop, plen, 1);
+    }
+
+  xop[0] = simplify_gen_subreg (QImode, op[0], mode, 0);
+  avr_asm_len ("neg %0", xop, plen, 1);
+
+  for (i = 1; i < n_bytes; i++)
+    {
+      xop[0] = simplify_gen_subreg (QImode, op[0], mode, i);
+      avr_asm_len ("sbci %0,-1", xop, plen, 1);
+    }
+
+  avr_asm_len ("brvc 0f", xop, plen, 1);
+
+  for (i = 0; i < n_bytes; i++)
+    {
+      xop[0] = simplify_gen_subreg (QImode, op[0], mode, i);
+      avr_asm_len ("dec %0", xop, plen, 1);
+    }
+
+  return avr_asm_len ("0:", xop, plen, 0);
+}
+
+
+/* Output inline "popcount", "parity", "clz", "ctz" resp. "ffs" of the
+   QI-, HI- or SImode register OP[1] as used for speed instead of the
+   libgcc calls.  The HImode result OP[0] is an LD_REGS register pair:
+   The low byte accumulates the result, the high byte serves as scratch
+   and is cleared at the end.  PLEN is as for avr_asm_len.  */
+
+const char*
+avr_out_bitcount (rtx_insn *insn, rtx *op, int *plen)
+{
+  rtx src = SET_SRC (single_set (insn));
+  machine_mode mode = GET_MODE (op[1]);
+  int i, k, n_bytes = GET_MODE_SIZE (mode);
+  enum rtx_code code;
+  rtx xop[4];
+
+  if (TRUNCATE == GET_CODE (src))
+    src = XEXP (src, 0);
+
+  code = GET_CODE (src);
+
+  xop[0] = simplify_gen_subreg (QImode, op[0], HImode, 0);
+  xop[1] = simplify_gen_subreg (QImode, op[0], HImode, 1);
+
+  if (plen)
+    *plen = 0;
+
+  switch (code)
+    {
+    case PARITY:
+      // XOR the bytes together, then fold the byte as in __parityqi2.
+      for (i = 0; i < n_bytes; i++)
+        {
+          xop[2] = simplify_gen_subreg (QImode, op[1], mode, i);
+          avr_asm_len (i == 0 ? "mov %0,%2" : "eor %0,%2", xop, plen, 1);
+        }
+
+      avr_asm_len ("mov __tmp_reg__,%0" CR_TAB
+                   "swap __tmp_reg__"   CR_TAB
+                   "eor %0,__tmp_reg__" CR_TAB
+                   "subi %0,-4"         CR_TAB
+                   "andi %0,-5"         CR_TAB
+                   "subi %0,-6"         CR_TAB
+                   "sbrc %0,3"          CR_TAB
+                   "inc %0"             CR_TAB
+                   "andi %0,1", xop, plen, 9);
+      break;
+
+    case POPCOUNT:
+      // Count the bits of each byte nibble-wise:  First the bit pairs
+      // Y = X - ((X >> 1) & 0x55), then the nibbles
+      // (Y & 0x33) + ((Y >> 2) & 0x33).  __tmp_reg__ has no ANDI, hence
+      // the latter is computed as  Y - 3 * ((Y >> 2) & 0x33)  for all
+      // bytes except the first.  The nibbles of up to 3 bytes can be
+      // summed up before they overflow.
+      for (i = 0; i < n_bytes; i++)
+        {
+          xop[2] = simplify_gen_subreg (QImode, op[1], mode, i);
+
+          if (i == 0)
+            {
+              avr_asm_len ("mov %0,%2"    CR_TAB
+                           "mov %1,%0"    CR_TAB
+                           "lsr %1"       CR_TAB
+                           "andi %1,0x55" CR_TAB
+                           "sub %0,%1"    CR_TAB
+                           "mov %1,%0"    CR_TAB
+                           "andi %1,0x33" CR_TAB
+                           "lsr %0"       CR_TAB
+                           "lsr %0"       CR_TAB
+                           "andi %0,0x33" CR_TAB
+                           "add %0,%1", xop, plen, 11);
+              continue;
+            }
+
+          avr_asm_len ("mov __tmp_reg__,%2"  CR_TAB
+                       "mov %1,%2"           CR_TAB
+                       "lsr %1"              CR_TAB
+                       "andi %1,0x55"        CR_TAB
+                       "sub __tmp_reg__,%1"  CR_TAB
+                       "mov %1,__tmp_reg__"  CR_TAB
+                       "lsr %1"              CR_TAB
+                       "lsr %1"              CR_TAB
+                       "andi %1,0x33"        CR_TAB
+                       "sub __tmp_reg__,%1"  CR_TAB
+                       "sub __tmp_reg__,%1"  CR_TAB
+                       "sub __tmp_reg__,%1", xop, plen, 12);
+
+          if (i < 3)
+            avr_asm_len ("add %0,__tmp_reg__", xop, plen, 1);
+          else
+            {
+              // Fold the 4th byte separately and add it to the folded
+              // sum of the first three.
+              avr_asm_len ("mov %1,%0"    CR_TAB
+                           "swap %1"      CR_TAB
+                           "andi %1,0x0f" CR_TAB
+                           "andi %0,0x0f" CR_TAB
+                           "add %0,%1"    CR_TAB
+                           "mov %1,__tmp_reg__" CR_TAB
+                           "swap %1"            CR_TAB
+                           "add %1,__tmp_reg__" CR_TAB
+                           "andi %1,0x0f"       CR_TAB
+                           "add %0,%1", xop, plen, 10);
+            }
+        }
+
+      // Add the nibbles.  A single byte has at most 4 bits per nibble,
+      // hence the high nibble of the sum doesn't matter.
+      if (n_bytes == 1)
+        avr_asm_len ("mov %1,%0"    CR_TAB
+                     "swap %1"      CR_TAB
+                     "add %0,%1"    CR_TAB
+                     "andi %0,0x0f", xop, plen, 4);
+      else if (n_bytes < 4)
+        avr_asm_len ("mov %1,%0"    CR_TAB
+                     "swap %1"      CR_TAB
+                     "andi %1,0x0f" CR_TAB
+                     "andi %0,0x0f" CR_TAB
+                     "add %0,%1", xop, plen, 5);
+      break;
+
+    case CLZ:
+    case CTZ:
+    case FFS:
+      // Scan for the first non-zero byte, starting at the high byte for
+      // CLZ and at the low byte otherwise.  The result is pre-set to the
+      // number of zero bits skipped so far, and the byte is then searched
+      // binary in %1.
+      for (k = 0; k < n_bytes; k++)
+        {
+          i = CLZ == code ? n_bytes - 1 - k : k;
+          xop[2] = simplify_gen_subreg (QImode, op[1], mode, i);
+          xop[3] = GEN_INT (8 * k + (FFS == code));
+          avr_asm_len ("mov %1,%2" CR_TAB
+                       "ldi %0,%3", xop, plen, 2);
+
+          if (k < n_bytes - 1)
+            avr_asm_len ("tst %1" CR_TAB
+                         "brne 1f", xop, plen, 2);
+        }
+
+      if (CLZ == code)
+        avr_asm_len ("1:"          CR_TAB
+                     "cpi %1,0x10" CR_TAB
+                     "brsh 2f"     CR_TAB
+                     "subi %0,-4"  CR_TAB
+                     "swap %1"     CR_TAB
+                     "2:"          CR_TAB
+                     "cpi %1,0x40" CR_TAB
+                     "brsh 3f"     CR_TAB
+                     "subi %0,-2"  CR_TAB
+                     "lsl %1"      CR_TAB
+                     "lsl %1"      CR_TAB
+                     "3:"          CR_TAB
+                     "sbrs %1,7"   CR_TAB
+                     "subi %0,-1", xop, plen, 11);
+      else
+        {
+          // Isolate the lowest set bit, then search its position.
+          avr_asm_len ("1:"                  CR_TAB
+                       "mov __tmp_reg__,%1"  CR_TAB
+                       "neg %1"              CR_TAB
+                       "and %1,__tmp_reg__"  CR_TAB
+                       "cpi %1,0x10"         CR_TAB
+                       "brlo 2f"             CR_TAB
+                       "subi %0,-4"          CR_TAB
+                       "swap %1"             CR_TAB
+                       "2:"                  CR_TAB
+                       "cpi %1,0x04"         CR_TAB
+                       "brlo 3f"             CR_TAB
+                       "subi %0,-2"          CR_TAB
+                       "lsr %1"              CR_TAB
+                       "lsr %1"              CR_TAB
+                       "3:"                  CR_TAB
+                       "sbrc %1,1"           CR_TAB
+                       "subi %0,-1", xop, plen, 14);
+
+          // ffs (0) = 0:  Only then %1 ends up as 0.
+          if (FFS == code)
+            avr_asm_len ("tst %1"  CR_TAB
+                         "brne 4f" CR_TAB
+                         "clr %0"  CR_TAB
+                         "4:", xop, plen, 3);
+        }
+      break;
+
+    default:
+      gcc_unreachable ();
+    }
+
+  return avr_asm_len ("clr %1", xop, plen, 1);
+}
+
+
+/* Output fixed-point rounding.  XOP[0] = XOP[1] is the operand to round.
+   XOP[2] is the rounding point, a CONST_INT.  The function prints the
+   instruction sequence if PLEN = NULL and computes the length in words
+   of the sequence if PLEN != NULL.  Most of this function deals with
+   preparing operands for calls to `avr_out_plus' and `avr_out_bitop'.  */
+
+const char*
+avr_out_round (rtx_insn *insn ATTRIBUTE_UNUSED, rtx *xop, int *plen)
+{
+  machine_mode mode = GET_MODE (xop[0]);
+  machine_mode imode = int_mode_for_mode (mode);
+  // The smallest fractional bit not cleared by the rounding is 2^(-RP).
+  int fbit = (int) GET_MODE_FBIT (mode);
+  double_int i_add = double_int_zero.set_bit (fbit-1 - INTVAL (xop[2]));
+  wide_int wi_add = wi::set_bit_in_zero (fbit-1 - INTVAL (xop[2]),
+					 GET_MODE_PRECISION (imode));
+  // Lengths of PLUS and AND parts.
+  int len_add = 0, *plen_add = plen ? &len_add : NULL;
+  int len_and = 0, *plen_and = plen ? &len_and : NULL;
+
+  // Add-Saturate  1/2 * 2^(-RP).  Don't print the label "0:" when printing
+  // the saturated addition so that we can emit the "rjmp 1f" before the
+  // "0:" below.
+
+  rtx xadd = const_fixed_from_double_int (i_add, mode);
+  rtx xpattern, xsrc, op[4];
+
+  xsrc = SIGNED_FIXED_POINT_MODE_P (mode)
+    ? gen_rtx_SS_PLUS (mode, xop[1], xadd)
     : gen_rtx_US_PLUS (mode, xop[1], xadd);
   xpattern = gen_rtx_SET (VOIDmode, xop[0], xsrc);
 
@@ -9063,12 +10605,19 @@ avr_adjust_insn_length (rtx_insn *insn, int len)
     case ADJUST_LEN_SFRACT: avr_out_fract (insn, op, true, &len); break;
     case ADJUST_LEN_UFRACT: avr_out_fract (insn, op, false, &len); break;
     case ADJUST_LEN_ROUND: avr_out_round (insn, op, &len); break;
+    case ADJUST_LEN_SS_ABS_NEG: avr_out_ss_abs_neg (insn, op, &len); break;
+    case ADJUST_LEN_BITCOUNT: avr_out_bitcount (insn, op, &len); break;
+    case ADJUST_LEN_ISR_SAVES: avr_out_isr_saves (op, &len); break;
+    case ADJUST_LEN_SKIP_MOV: avr_out_skip_mov (insn, op, &len); break;
 
     case ADJUST_LEN_TSTHI: avr_out_tsthi (insn, op, &len); break;
     case ADJUST_LEN_TSTPSI: avr_out_tstpsi (insn, op, &len); break;
     case ADJUST_LEN_TSTSI: avr_out_tstsi (insn, op, &len); break;
     case ADJUST_LEN_COMPARE: avr_out_compare (insn, op, &len); break;
     case ADJUST_LEN_COMPARE64: avr_out_compare64 (insn, op, &len); break;
+    case ADJUST_LEN_SHIFT64: avr_out_shift64 (insn, op, &len); break;
+    case ADJUST_LEN_MULSIDI3: avr_out_mulsidi3 (insn, op, &len); break;
+    case ADJUST_LEN_MUL_FIXED: avr_out_mul_fixed (insn, op, &len); break;
 
     case ADJUST_LEN_LSHRQI: lshrqi3_out (insn, op, &len); break;
     case ADJUST_LEN_LSHRHI: lshrhi3_out (insn, op, &len); break;
@@ -9671,6 +11220,8 @@ avr_attribute_table[] =
     false },
   { "handler",   1, 1, false, false, false, avr_handle_isr_handler_attribute,
     false },
+  { "vector_slot", 0, 0, true, false, false, avr_handle_fndecl_attribute,
+    false },
   { "at",        1, 1, false, false, false, avr_handle_at_attribute,
     false },
   { "persistent",0, 0, false, false, false, avr_handle_persistent_attribute,
@@ -10728,13 +12279,43 @@ avr_file_start (void)
 
 AvrDeviceConfig DeviceConfigurations;
 
-void
-avr_output_configurations (void)
+/* The value REG holds if no #pragma config touched it.  */
+
+static uint32_t
+avr_config_reg_default (ConfigReg &Reg)
 {
-	/* Return if no configurations changed.  */
-	if (!DeviceConfigurations.AreConfigsChanged) return;
+  uint32_t RegValue = Reg.factorydefault;
+
+  for (ConfigIterator C = Reg.configs.begin(); C != Reg.configs.end(); C++)
+    {
+      RegValue = RegValue & (~(C->mask << C->bitPos));
+      RegValue |= (C->default_value << C->bitPos);
+    }
+
+  return RegValue & ((1 << Reg.width) - 1);
+}
 
-  fprintf (asm_out_file, "# Microchip Technology AVR MCU configurations\n");
+/* Return the assembler code that records the configuration values of this
+   TU.  The configurations of several TUs must merge, hence every byte of a
+   space is represented by an absolute symbol __config_<space>_<offset> that
+   holds the difference to the factory default.  Only the TU that set a field
+   of a register defines the symbols of that register, and it defines them
+   global and not weak:  When two TUs set the same register, the link fails
+   with a multiple definition (or, with all TUs in one LTO partition, the
+   assembler rejects the second .equiv).
+
+   Each TU also provides the image of the space in the COMDAT group
+   __config_group_<space> of section .fuse so that the linker keeps exactly
+   one of them.  The image adds the symbols to the defaults by means of
+   lo8 relocations.  Symbols no TU defines are made weak by macro
+   __config_end which is invoked at the end of the file, see avr_file_end.
+   Undefined weak symbols resolve to 0 and the default value remains.  */
+
+static std::string
+avr_config_asm (void)
+{
+  std::string text = "# Microchip Technology AVR MCU configurations\n";
+  char buf[128];
 
   for (SpaceIterator itSpace = DeviceConfigurations.Spaces.begin();
        itSpace != DeviceConfigurations.Spaces.end(); itSpace++)
@@ -10742,9 +12323,9 @@ avr_output_configurations (void)
       if (false == itSpace->isReferenced)
         continue;
 
-      fprintf (asm_out_file, "\t.section\t.fuse, data\n");
+      const char *sname = itSpace->sname.c_str();
+      std::string image;
 
-      uint32_t RegIndex = 0;
       for (RegIterator itR = itSpace->registers.begin();
            itR != itSpace->registers.end(); itR++)
         {
@@ -10753,24 +12334,127 @@ avr_output_configurations (void)
             {
               error ("Invalid size (%d bits) for config register %qs.",
                      RegWidthBits, itR->rname.c_str());
-              return;
+              return "";
             }
-          fprintf (asm_out_file, "\t.type\t__config_REG_%02X, @object\n",
-                   RegIndex);
-          fprintf (asm_out_file, "\t.size\t__config_REG_%02X, %d\n", RegIndex,
-                   RegWidthBits / 8);
-          fprintf (asm_out_file, "__config_REG_%02X:\n", RegIndex);
+
+          bool modified = false;
+          for (ConfigIterator C = itR->configs.begin();
+               C != itR->configs.end(); C++)
+            modified |= C->isModified;
 
           uint32_t RegValue = itR->GetValue();
-          int8_t index = 0;
-          while (index < RegWidthBits)
+          uint32_t RegDefault = avr_config_reg_default (*itR);
+
+          for (int index = 0; index < RegWidthBits; index += 8)
+            {
+              unsigned int offset = itR->offset + index / 8;
+              unsigned int value = 0xff & (RegValue >> index);
+              unsigned int defval = 0xff & (RegDefault >> index);
+
+              if (modified)
+                {
+                  snprintf (buf, sizeof (buf),
+                            "\t.global\t__config_%s_%02X\n"
+                            "\t.equiv\t__config_%s_%02X, 0x%02X\n",
+                            sname, offset, sname, offset,
+                            0xff & (value - defval));
+                  text += buf;
+                }
+
+              snprintf (buf, sizeof (buf),
+                        "\t.byte\tlo8(__config_%s_%02X+0x%02X)\n",
+                        sname, offset, defval);
+              image += buf;
+            }
+        }
+
+      snprintf (buf, sizeof (buf),
+                "\t.ifndef\t__config_image_%s\n"
+                "\t.set\t__config_image_%s, 1\n"
+                "\t.pushsection\t.fuse,\"awG\",@progbits,"
+                "__config_group_%s,comdat\n", sname, sname, sname);
+      text += buf;
+      text += image;
+      text += "\t.popsection\n\t.endif\n";
+    }
+
+  /* The weak declarations must follow the definitions of all TUs, hence
+     they are wrapped in a macro that covers all spaces of the device.  */
+
+  text += "\t.ifndef\t__config_end_defined\n"
+    "\t.set\t__config_end_defined, 1\n"
+    "\t.macro\t__config_end\n";
+
+  for (SpaceIterator itSpace = DeviceConfigurations.Spaces.begin();
+       itSpace != DeviceConfigurations.Spaces.end(); itSpace++)
+    {
+      const char *sname = itSpace->sname.c_str();
+
+      snprintf (buf, sizeof (buf), "\t.ifdef\t__config_image_%s\n", sname);
+      text += buf;
+
+      for (RegIterator itR = itSpace->registers.begin();
+           itR != itSpace->registers.end(); itR++)
+        for (int index = 0; index < itR->width; index += 8)
           {
-            fprintf (asm_out_file, "\t.byte\t0x%02X\n", (0x000000ff & (RegValue >> index)));
-            index += 8;
+            unsigned int offset = itR->offset + index / 8;
+            snprintf (buf, sizeof (buf),
+                      "\t.ifndef\t__config_%s_%02X\n"
+                      "\t.weak\t__config_%s_%02X\n"
+                      "\t.endif\n", sname, offset, sname, offset);
+            text += buf;
           }
-          RegIndex += RegWidthBits / 8;
-        }
+
+      text += "\t.endif\n";
     }
+
+  text += "\t.endm\n\t.endif\n";
+
+  return text;
+}
+
+/* With -flto, the configuration code from avr_config_asm is not printed by
+   avr_output_configurations but held in a toplevel asm statement.  Like any
+   other toplevel asm it is streamed to the LTO IR and emitted by the first
+   ltrans partition, hence the conflict checks of avr_config_asm also work
+   with all TUs in one assembly file.
+
+   This is called after each #pragma config, i.e. before the IR is
+   streamed out.  */
+
+static asm_node *avr_config_asm_node;
+
+void
+avr_update_config_asm (void)
+{
+  if (!flag_generate_lto)
+    return;
+
+  std::string text = avr_config_asm ();
+  tree asm_str = build_string (text.length(), text.c_str());
+
+  if (avr_config_asm_node)
+    avr_config_asm_node->asm_str = asm_str;
+  else
+    avr_config_asm_node = symtab->finalize_toplevel_asm (asm_str);
+}
+
+void
+avr_output_configurations (void)
+{
+  /* With -flto the code is emitted by avr_update_config_asm.  The macro
+     still has to be invoked: In the first ltrans partition the toplevel
+     asm of the TUs defines it.  */
+
+  if (DeviceConfigurations.AreConfigsChanged
+      && !flag_generate_lto)
+    fputs (avr_config_asm ().c_str(), asm_out_file);
+
+  if (DeviceConfigurations.AreConfigsChanged
+      || in_lto_p)
+    fputs ("\t.ifdef\t__config_end_defined\n"
+           "\t__config_end\n"
+           "\t.endif\n", asm_out_file);
 }
 
 /* Implement `TARGET_ASM_FILE_END'.  */
@@ -10783,6 +12467,8 @@ avr_file_end (void)
   /* Output the configuration values.  */
   avr_output_configurations();
 
+  avr_time_report_output ();
+
   /* Output these only if there is anything in the
      .data* / .rodata* / .gnu.linkonce.* resp. .bss* or COMMON
      input section(s) - some code size can be saved by not
@@ -10901,6 +12587,65 @@ avr_memory_move_cost (machine_mode mode,
 }
 
 
+/* Return the number of cycles of a MODE multiplication on a device with
+   MUL.  WIDEN_P: The factors are extended from half of MODE or narrower.
+   INLINE_P: Cycles of the inline sequences "mulsi3_inline",
+   "<extend_u>mulhisi3_inline", "usmulhisi3_inline", "mulpsi3_inline",
+   "<extend_u>mulsidi3_inline_insn" and the fixed-point "mul<mode>3_inline"
+   resp. "mul<mode>3_inline_insn", otherwise the cycles of the respective
+   libgcc function plus the CALL / RET and the moves to and from its
+   argument registers.  */
+
+static int
+avr_mul_cycles (machine_mode mode, bool widen_p, bool inline_p)
+{
+  int call = (AVR_HAVE_JMP_CALL ? 4 : 3) + (AVR_3_BYTE_PC ? 5 : 4) + 3;
+
+  switch (mode)
+    {
+    case PSImode:
+      return inline_p ? 21 : 33 + call;
+
+    case SImode:
+      if (widen_p)
+        return inline_p ? 23 : 21 + call;
+      return inline_p ? 38 : 54 + call;
+
+    case DImode:
+      gcc_assert (widen_p);
+      return inline_p ? 93 : 120 + call;
+
+    case HQmode:  return inline_p ? 35 : 51 + call;
+    case UHQmode: return inline_p ? 21 : 33 + call;
+    case HAmode:  return inline_p ? 26 : 47 + call;
+    case UHAmode: return inline_p ? 17 : 37 + call;
+    case SAmode:  return inline_p ? 89 : 95 + call;
+    case USAmode: return inline_p ? 76 : 85 + call;
+
+    default:
+      gcc_unreachable ();
+    }
+}
+
+
+/* Return true if a MODE multiplication shall be expanded inline instead
+   of calling libgcc, i.e. if the current function is optimized for speed
+   and the inline sequence takes fewer cycles.  WIDEN_P is as for
+   avr_mul_cycles.  Code size is what counts with -Os, hence we keep the
+   libgcc calls there.  */
+
+bool
+avr_mul_inline_p (machine_mode mode, bool widen_p)
+{
+  return (AVR_HAVE_MUL
+          && optimize
+          && cfun
+          && optimize_function_for_speed_p (cfun)
+          && (avr_mul_cycles (mode, widen_p, true)
+              < avr_mul_cycles (mode, widen_p, false)));
+}
+
+
 /* Mutually recursive subroutine of avr_rtx_cost for calculating the
    cost of an RTX operand given its context.  X is the rtx of the
    operand, MODE is its mode, and OUTER is the rtx_code of this
@@ -11199,6 +12944,8 @@ avr_rtx_costs_1 (rtx x, int codearg, int outer_code ATTRIBUTE_UNUSED,
         case PSImode:
           if (!speed)
             *total = COSTS_N_INSNS (AVR_HAVE_JMP_CALL ? 2 : 1);
+          else if (avr_mul_inline_p (PSImode, false))
+            *total = COSTS_N_INSNS (avr_mul_cycles (PSImode, false, true));
           else
             *total = 10;
           break;
@@ -11207,12 +12954,28 @@ avr_rtx_costs_1 (rtx x, int codearg, int outer_code ATTRIBUTE_UNUSED,
 	case DImode:
 	  if (AVR_HAVE_MUL)
             {
+              bool widen_p
+                = ((ZERO_EXTEND == GET_CODE (XEXP (x, 0))
+                    || SIGN_EXTEND == GET_CODE (XEXP (x, 0)))
+                   && (ZERO_EXTEND == GET_CODE (XEXP (x, 1))
+                       || SIGN_EXTEND == GET_CODE (XEXP (x, 1)))
+                   && GET_MODE_SIZE (GET_MODE (XEXP (XEXP (x, 0), 0))) <= 2
+                   && GET_MODE_SIZE (GET_MODE (XEXP (XEXP (x, 1), 0))) <= 2);
+
               if (!speed)
                 {
                   /* Add some additional costs besides CALL like moves etc.  */
 
                   *total = COSTS_N_INSNS (AVR_HAVE_JMP_CALL ? 5 : 4);
                 }
+              else if (SImode == mode
+                       && avr_mul_inline_p (SImode, widen_p))
+                {
+                  /* Inline sequence composed of MUL partial products.  */
+
+                  *total = COSTS_N_INSNS (avr_mul_cycles (SImode, widen_p,
+                                                          true));
+                }
               else
                 {
                   /* Just a rough estimate.  Even with -O2 we don't want bulky
@@ -11756,6 +13519,38 @@ avr_rtx_costs_1 (rtx x, int codearg, int outer_code ATTRIBUTE_UNUSED,
       *total += avr_operand_rtx_cost (XEXP (x, 0), mode, code, 0, speed);
       return true;
 
+    case POPCOUNT:
+    case PARITY:
+    case CLZ:
+    case CTZ:
+    case FFS:
+      {
+        /* Inline code from avr_out_bitcount for speed, libgcc call
+           otherwise.  */
+
+        machine_mode op_mode = GET_MODE (XEXP (x, 0));
+        int n_bytes = GET_MODE_SIZE (op_mode);
+
+        if (!speed)
+          *total = COSTS_N_INSNS (AVR_HAVE_JMP_CALL ? 2 : 1);
+        else if (POPCOUNT == code)
+          *total = COSTS_N_INSNS (15 * n_bytes);
+        else if (PARITY == code)
+          *total = COSTS_N_INSNS (10 + n_bytes);
+        else
+          *total = COSTS_N_INSNS (12 + 4 * n_bytes + 3 * (FFS == code));
+
+        *total += avr_operand_rtx_cost (XEXP (x, 0), op_mode, code, 0, speed);
+        return true;
+      }
+
+    case BSWAP:
+      *total = speed
+        ? COSTS_N_INSNS (GET_MODE_SIZE (mode))
+        : COSTS_N_INSNS (AVR_HAVE_JMP_CALL ? 2 : 1);
+      *total += avr_operand_rtx_cost (XEXP (x, 0), mode, code, 0, speed);
+      return true;
+
     case TRUNCATE:
       if (AVR_HAVE_MUL
           && LSHIFTRT == GET_CODE (XEXP (x, 0))
@@ -11767,6 +13562,22 @@ avr_rtx_costs_1 (rtx x, int codearg, int outer_code ATTRIBUTE_UNUSED,
               *total = COSTS_N_INSNS (2);
               return true;
             }
+
+          /* Multiply-high as used by expmed.c to divide by a constant,
+             see <extend_su>mulsi3_highpart.  The inline product resp. the
+             call of __[u]mulsidi3 takes some 90 cycles which is still far
+             less than the 600 cycles of __[u]divmodsi4, or 400 of
+             __[u]divmodpsi4.  For size, the call plus the shifts and
+             additions around it are larger than the plain division call
+             which hence is kept.  */
+
+          if (SImode == mode || PSImode == mode)
+            {
+              *total = speed
+                ? COSTS_N_INSNS (SImode == mode ? 20 : 22)
+                : COSTS_N_INSNS (AVR_HAVE_JMP_CALL ? 6 : 5);
+              return true;
+            }
         }
       break;
 
@@ -12056,104 +13867,869 @@ avr_reorg_remove_redundant_compare (rtx_insn *insn1)
       return false;
     }
 
-  /* Wrap the branches into UNSPECs so they won't be changed or
-     optimized in the remainder.  */
+  /* Wrap the branches into UNSPECs so they won't be changed or
+     optimized in the remainder.  */
+
+  target = XEXP (XEXP (ifelse1, 1), 0);
+  cond = XEXP (ifelse1, 0);
+  jump = emit_jump_insn_after (gen_branch_unspec (target, cond), insn1);
+
+  JUMP_LABEL (jump) = JUMP_LABEL (branch1);
+
+  target = XEXP (XEXP (ifelse2, 1), 0);
+  cond = gen_rtx_fmt_ee (code, VOIDmode, cc0_rtx, const0_rtx);
+  jump = emit_jump_insn_after (gen_branch_unspec (target, cond), insn2);
+
+  JUMP_LABEL (jump) = JUMP_LABEL (branch2);
+
+  /* The comparisons in insn1 and insn2 are exactly the same;
+     insn2 is superfluous so delete it.  */
+
+  delete_insn (insn2);
+  delete_insn (branch1);
+  delete_insn (branch2);
+
+  return true;
+}
+
+
+static bool avr_2word_insn_p (rtx_insn*);
+
+/* Helper for `avr_reorg_skip_if_convert':  Return true if INSN is a
+   QImode move.  If SKIP_P, the move must also be skippable, i.e. be a
+   1-word instruction or a 2-word LDS / STS.  */
+
+static bool
+avr_skip_move_p (rtx_insn *insn, bool skip_p)
+{
+  if (!NONJUMP_INSN_P (insn))
+    return false;
+
+  switch (recog_memoized (insn))
+    {
+    default:
+      return false;
+
+    case CODE_FOR_movqi_insn:
+    case CODE_FOR_movqq_insn:
+    case CODE_FOR_movuqq_insn:
+      return (!skip_p
+              || 1 == get_attr_length (insn)
+              || avr_2word_insn_p (insn));
+    }
+}
+
+
+/* Helper for `avr_reorg':  If-convert
+
+       if (COND) goto L1     ; with a cc0 compare in front for CPSE
+       A
+       goto L2
+   L1: B
+   L2:
+
+   where A and B are QImode moves to the same destination.  One of the
+   moves is performed unconditionally, the other one becomes the
+   conditional move "*skip_mov<mode>" that skips the move if it must not
+   take effect:
+
+       A                     ; or B
+       CPSE / SBRC / SBRS / SBIC / SBIS
+       B                     ; or A
+
+   COND compares two QImode registers (CPSE), or it tests a single bit of
+   a register (SBRC / SBRS) or of a low I/O register (SBIC / SBIS).  CPSE
+   can only skip if equal, which determines which move is conditional.
+   2-word LDS / STS are only skipped if !TARGET_SKIP_BUG.
+
+   JUMP is a conditional jump.  Return the conditional move insn if the
+   transformation was performed, and NULL otherwise.  */
+
+static rtx_insn*
+avr_reorg_skip_if_convert (rtx_insn *jump)
+{
+  rtx_insn *compare = NULL, *a, *jump2, *barrier, *label1, *b, *label2;
+  rtx_insn *uncond, *cond_arm, *skip;
+  rtx set = pc_set (jump);
+  rtx ifelse, cond, xop0, xop1, dest, xcond, src_cond;
+  enum rtx_code code;
+  bool ok;
+
+  if (!set)
+    return NULL;
+
+  ifelse = SET_SRC (set);
+
+  if (IF_THEN_ELSE != GET_CODE (ifelse)
+      || LABEL_REF != GET_CODE (XEXP (ifelse, 1))
+      || pc_rtx != XEXP (ifelse, 2))
+    return NULL;
+
+  cond = XEXP (ifelse, 0);
+  code = GET_CODE (cond);
+  xop0 = XEXP (cond, 0);
+  xop1 = XEXP (cond, 1);
+
+  if (code != EQ && code != NE)
+    return NULL;
+
+  if (cc0_rtx == xop0)
+    {
+      rtx cset;
+
+      compare = prev_nonnote_nondebug_insn (jump);
+      cset = compare && NONJUMP_INSN_P (compare) ? single_set (compare) : NULL;
+
+      if (!cset
+          || cc0_rtx != SET_DEST (cset)
+          || COMPARE != GET_CODE (SET_SRC (cset)))
+        return NULL;
+
+      xop0 = XEXP (SET_SRC (cset), 0);
+      xop1 = XEXP (SET_SRC (cset), 1);
+
+      if (!REG_P (xop0)
+          || 1 != GET_MODE_SIZE (GET_MODE (xop0))
+          || !(REG_P (xop1)
+               || xop1 == CONST0_RTX (GET_MODE (xop0))))
+        return NULL;
+    }
+  else if (ZERO_EXTRACT != GET_CODE (xop0)
+           || const0_rtx != xop1
+           || recog_memoized (jump) < 0
+           || (MEM_P (XEXP (xop0, 0))
+               && !low_io_address_operand (XEXP (XEXP (xop0, 0), 0), QImode)))
+    return NULL;
+
+  /* Match the diamond.  */
+
+  a = next_nonnote_nondebug_insn (jump);
+  jump2 = a ? next_nonnote_nondebug_insn (a) : NULL;
+  barrier = jump2 ? next_nonnote_nondebug_insn (jump2) : NULL;
+  label1 = barrier ? next_nonnote_nondebug_insn (barrier) : NULL;
+  b = label1 ? next_nonnote_nondebug_insn (label1) : NULL;
+  label2 = b ? next_nonnote_nondebug_insn (b) : NULL;
+
+  if (!label2
+      || !simplejump_p (jump2)
+      || !BARRIER_P (barrier)
+      || label1 != JUMP_LABEL (jump)
+      || LABEL_NUSES (label1) != 1
+      || label2 != JUMP_LABEL (jump2)
+      || !avr_skip_move_p (a, false)
+      || !avr_skip_move_p (b, false)
+      || !rtx_equal_p (SET_DEST (single_set (a)), SET_DEST (single_set (b))))
+    return NULL;
+
+  /* B takes effect if COND is true, A if COND is false.  */
+
+  if (compare ? NE == code : avr_skip_move_p (b, true))
+    {
+      uncond = a;
+      cond_arm = b;
+      xcond = gen_rtx_fmt_ee (code, VOIDmode, xop0, xop1);
+    }
+  else
+    {
+      uncond = b;
+      cond_arm = a;
+      xcond = gen_rtx_fmt_ee (reverse_condition (code), VOIDmode, xop0, xop1);
+    }
+
+  dest = SET_DEST (single_set (uncond));
+  src_cond = SET_SRC (single_set (cond_arm));
+
+  /* The unconditional move must not change the condition or the source
+     of the conditional move, and it must have no side effects.  */
+
+  if (!avr_skip_move_p (cond_arm, true)
+      || side_effects_p (PATTERN (uncond))
+      || volatile_refs_p (PATTERN (uncond))
+      || reg_overlap_mentioned_p (dest, xop0)
+      || reg_overlap_mentioned_p (dest, xop1)
+      || reg_overlap_mentioned_p (dest, src_cond))
+    return NULL;
+
+  set = gen_rtx_SET (VOIDmode, copy_rtx (dest),
+                     gen_rtx_IF_THEN_ELSE (GET_MODE (dest), copy_rtx (xcond),
+                                           copy_rtx (src_cond),
+                                           copy_rtx (dest)));
+
+  skip = emit_insn_before (set, compare ? compare : jump);
+
+  ok = recog_memoized (skip) >= 0;
+
+  if (ok)
+    {
+      extract_insn (skip);
+      ok = (constrain_operands (1, get_enabled_alternatives (skip))
+            && get_attr_length (skip) == 1 + get_attr_length (cond_arm));
+    }
+
+  if (!ok)
+    {
+      delete_insn (skip);
+      return NULL;
+    }
+
+  emit_insn_before (copy_rtx (PATTERN (uncond)), skip);
+
+  if (dump_file)
+    fprintf (dump_file, ";; if-converted jump insn %d to skip insn %d\n",
+             INSN_UID (jump), INSN_UID (skip));
+
+  if (compare)
+    delete_insn (compare);
+  delete_insn (jump);
+  delete_insn (a);
+  delete_insn (jump2);
+  delete_insn (barrier);
+  delete_insn (label1);
+  delete_insn (b);
+
+  if (0 == LABEL_NUSES (label2)
+      && !LABEL_PRESERVE_P (label2))
+    delete_insn (label2);
+
+  return skip;
+}
+
+
+/* Helper for avr_isr_scan_saves:  Return a mask of the AVR_ISR_* registers
+   that INSN might use.  The RTL never mentions SREG and only rarely
+   mentions __tmp_reg__ or __zero_reg__, hence rely on insn attribute
+   "isr_regs" for what the output function does behind the scenes.  */
+
+static int
+avr_isr_insn_uses (rtx_insn *insn)
+{
+  rtx set, dest, src;
+  int uses = 0;
+
+  if (CALL_P (insn)
+      || recog_memoized (insn) < 0)
+    return AVR_ISR_ALL;
+
+  extract_constrain_insn_cached (insn);
+
+  if (reg_mentioned_p (tmp_reg_rtx, PATTERN (insn)))
+    uses |= AVR_ISR_TMP;
+
+  if (reg_mentioned_p (zero_reg_rtx, PATTERN (insn)))
+    uses |= AVR_ISR_ZERO;
+
+  switch (get_attr_isr_regs (insn))
+    {
+    default:
+      return AVR_ISR_ALL;
+
+    case ISR_REGS_NONE:
+      return uses;
+
+    case ISR_REGS_CC:
+      if (get_attr_cc (insn) != CC_NONE)
+        uses |= AVR_ISR_SREG;
+      break;
+
+    case ISR_REGS_MOVE:
+      dest = recog_data.operand[0];
+      src = recog_data.operand[1];
+
+      /* LPM loads to R0, ELPM needs __tmp_reg__ to set RAMPZ.  */
+
+      if (avr_mem_flash_p (src)
+          || avr_mem_flash_p (dest))
+        return AVR_ISR_ALL;
+
+      /* Accesses by reg+disp might adjust the pointer register with
+         ADIW / SBIW, and stores use __tmp_reg__ for a source that
+         overlaps the pointer.  */
+
+      if ((MEM_P (src) && GET_CODE (XEXP (src, 0)) == PLUS)
+          || (MEM_P (dest) && GET_CODE (XEXP (dest, 0)) == PLUS))
+        uses |= AVR_ISR_TMP | AVR_ISR_SREG;
+      break;
+    }
+
+  /* Storing zero to memory or to a register not in LD_REGS reads
+     __zero_reg__, cf. "push<mode>1", output_movqi and
+     output_reload_in_const.  */
+
+  set = single_set (insn);
+
+  if (set)
+    {
+      dest = SET_DEST (set);
+      src = SET_SRC (set);
+
+      if (src == CONST0_RTX (GET_MODE (dest))
+          && !(REG_P (dest)
+               && test_hard_reg_class (LD_REGS, dest)))
+        uses |= AVR_ISR_ZERO;
+    }
+
+  return uses;
+}
+
+
+/* Worker for the "avr-isr-saves" pass:  Find out which of SREG,
+   __tmp_reg__ and __zero_reg__ are used by the insns of the current ISR
+   except "isr_saves".  Registers that are not used need not be saved
+   resp. restored by "isr_saves", which is recorded in
+   `cfun->machine->isr_skip_saves'.  This runs after branch shortening:
+   Omitting code from "isr_saves" does not increase the distance of any
+   branch, and the insn lengths are recomputed afterwards.  */
+
+static void
+avr_isr_scan_saves (void)
+{
+  rtx_insn *prologue = NULL;
+  int uses = 0, skip, n_skip;
+
+  for (rtx_insn *insn = get_insns (); insn; insn = NEXT_INSN (insn))
+    {
+      rtx pat;
+
+      if (!NONDEBUG_INSN_P (insn))
+        continue;
+
+      pat = PATTERN (insn);
+
+      if (GET_CODE (pat) == USE
+          || GET_CODE (pat) == CLOBBER)
+        continue;
+
+      if (GET_CODE (pat) == PARALLEL
+          && GET_CODE (XVECEXP (pat, 0, 0)) == UNSPEC_VOLATILE
+          && XINT (XVECEXP (pat, 0, 0), 1) == UNSPECV_ISR_SAVES)
+        {
+          if (INTVAL (XVECEXP (XVECEXP (pat, 0, 0), 0, 0)))
+            prologue = insn;
+          continue;
+        }
+
+      uses |= avr_isr_insn_uses (insn);
+
+      if (uses == AVR_ISR_ALL)
+        break;
+    }
+
+  /* Clearing zero reg clobbers SREG, and SREG is saved by means of
+     tmp reg.  */
+
+  if (uses & AVR_ISR_ZERO)
+    uses |= AVR_ISR_SREG;
+
+  if (uses & AVR_ISR_SREG)
+    uses |= AVR_ISR_TMP;
+
+  skip = AVR_ISR_ALL & ~uses;
+  n_skip = avr_popcount (skip);
+
+  if (dump_file)
+    fprintf (dump_file, ";; ISR saves:%s%s%s\n",
+             (skip & AVR_ISR_ZERO) ? "" : " __zero_reg__",
+             (skip & AVR_ISR_TMP) ? "" : " __tmp_reg__",
+             (skip & AVR_ISR_SREG) ? "" : " SREG");
+
+  if (!prologue || n_skip == 0)
+    return;
+
+  cfun->machine->isr_skip_saves = skip;
+  cfun->machine->stack_usage -= n_skip;
+
+  if (flag_stack_usage_info)
+    current_function_static_stack_size -= n_skip;
+
+  avr_isr_saves_frame_note (prologue);
+
+  /* The lengths of the "isr_saves" insns as cached by "shorten" are
+     those of the full sequences.  */
+
+  shorten_branches (get_insns ());
+}
+
+
+/* Return the number of the interrupt vector served by ISR DECL as given by
+   attribute "handler" or by a name of the form __vector_<N>.  Return -1
+   if the number is unknown.  */
+
+static int
+avr_isr_vector_number (tree decl)
+{
+  tree attr = lookup_attribute ("handler", DECL_ATTRIBUTES (decl));
+  const char *name;
+  char *end;
+  long num;
+
+  if (attr)
+    return (int) tree_to_uhwi (TREE_VALUE (TREE_VALUE (attr)));
+
+  name = IDENTIFIER_POINTER (DECL_ASSEMBLER_NAME (decl));
+  name = default_strip_name_encoding (name);
+
+  if (!STR_PREFIX_P (name, "__vector_")
+      || !ISDIGIT (name[strlen ("__vector_")]))
+    return -1;
+
+  num = strtol (name + strlen ("__vector_"), &end, 10);
+
+  return *end || num > INT_MAX ? -1 : (int) num;
+}
+
+
+/* Worker for the "avr-vector-slot" pass:  If the current ISR fits into
+   its interrupt vector slot of 1 resp. 2 words, or if it serves the last
+   vector as of -mlast-vector=, then put it into section .vectors.<N> so
+   that the slot holds the ISR itself instead of a jump to it.  This is
+   done for all such ISRs with -mvector-slot-isrs, and on request by
+   attribute "vector_slot".  */
+
+static void
+avr_isr_vector_slot (void)
+{
+  tree decl = current_function_decl;
+  bool attr_p = NULL_TREE != lookup_attribute ("vector_slot",
+                                               DECL_ATTRIBUTES (decl));
+  location_t loc = DECL_SOURCE_LOCATION (decl);
+  int vector = avr_isr_vector_number (decl);
+  int slot = AVR_HAVE_JMP_CALL ? 2 : 1;
+  int len = 0;
+  char section[30];
+
+  if (vector < 0)
+    {
+      if (attr_p)
+        warning_at (loc, OPT_Wattributes, "%qs attribute ignored: vector "
+                    "number of %qD is unknown", "vector_slot", decl);
+      return;
+    }
+
+  if (DECL_SECTION_NAME (decl))
+    {
+      if (attr_p)
+        warning_at (loc, OPT_Wattributes, "%qs attribute ignored: %qD is "
+                    "located in section %qs", "vector_slot", decl,
+                    DECL_SECTION_NAME (decl));
+      return;
+    }
+
+  /* The lengths are the ones computed by "shorten".  Compute the length
+     of "isr_saves" anew:  It depends on what avr_isr_scan_saves found out
+     after "shorten".  */
+
+  for (rtx_insn *insn = get_insns (); insn; insn = NEXT_INSN (insn))
+    if (NONDEBUG_INSN_P (insn))
+      {
+        int n_words = get_attr_length (insn);
+
+        if (recog_memoized (insn) >= 0
+            && ADJUST_LEN_ISR_SAVES == get_attr_adjust_len (insn))
+          {
+            extract_insn_cached (insn);
+            avr_out_isr_saves (recog_data.operand, &n_words);
+          }
+
+        len += n_words;
+      }
+
+  if (dump_file)
+    fprintf (dump_file, ";; ISR for vector %d: %d words, slot: %d words\n",
+             vector, len, slot);
+
+  if (len > slot
+      && vector != avr_last_vector)
+    {
+      if (attr_p)
+        warning_at (loc, OPT_Wattributes, "%qs attribute ignored: %qD needs"
+                    " %d words which exceeds the vector slot",
+                    "vector_slot", decl, len);
+      return;
+    }
+
+  sprintf (section, ".vectors.%d", vector);
+  set_decl_section_name (decl, section);
+}
+
+
+/* Implement `TARGET_MACHINE_DEPENDENT_REORG'.  */
+/* Optimize conditional jumps.  */
+
+static void
+avr_reorg (void)
+{
+  rtx_insn *insn = get_insns();
+
+  if (optimize
+      && flag_if_conversion2)
+    {
+      for (rtx_insn *next; insn; insn = next)
+        {
+          rtx_insn *skip = JUMP_P (insn)
+            ? avr_reorg_skip_if_convert (insn)
+            : NULL;
+
+          next = NEXT_INSN (skip ? skip : insn);
+        }
+
+      insn = get_insns();
+    }
+
+  for (insn = next_real_insn (insn); insn; insn = next_real_insn (insn))
+    {
+      rtx pattern = avr_compare_pattern (insn);
+
+      if (!pattern)
+        continue;
+
+      if (optimize
+          && avr_reorg_remove_redundant_compare (insn))
+        {
+          continue;
+        }
+
+      if (compare_diff_p (insn))
+	{
+          /* Now we work under compare insn with difficult branch.  */
+
+          rtx next = next_real_insn (insn);
+          rtx pat = PATTERN (next);
+
+          pattern = SET_SRC (pattern);
+
+          if (true_regnum (XEXP (pattern, 0)) >= 0
+              && true_regnum (XEXP (pattern, 1)) >= 0)
+            {
+              rtx x = XEXP (pattern, 0);
+              rtx src = SET_SRC (pat);
+              rtx t = XEXP (src,0);
+              PUT_CODE (t, swap_condition (GET_CODE (t)));
+              XEXP (pattern, 0) = XEXP (pattern, 1);
+              XEXP (pattern, 1) = x;
+              INSN_CODE (next) = -1;
+            }
+          else if (true_regnum (XEXP (pattern, 0)) >= 0
+                   && XEXP (pattern, 1) == const0_rtx)
+            {
+              /* This is a tst insn, we can reverse it.  */
+              rtx src = SET_SRC (pat);
+              rtx t = XEXP (src,0);
+
+              PUT_CODE (t, swap_condition (GET_CODE (t)));
+              XEXP (pattern, 1) = XEXP (pattern, 0);
+              XEXP (pattern, 0) = const0_rtx;
+              INSN_CODE (next) = -1;
+              INSN_CODE (insn) = -1;
+            }
+          else if (true_regnum (XEXP (pattern, 0)) >= 0
+                   && CONST_INT_P (XEXP (pattern, 1)))
+            {
+              rtx x = XEXP (pattern, 1);
+              rtx src = SET_SRC (pat);
+              rtx t = XEXP (src,0);
+              machine_mode mode = GET_MODE (XEXP (pattern, 0));
+
+              if (avr_simplify_comparison_p (mode, GET_CODE (t), x))
+                {
+                  XEXP (pattern, 1) = gen_int_mode (INTVAL (x) + 1, mode);
+                  PUT_CODE (t, avr_normalize_condition (GET_CODE (t)));
+                  INSN_CODE (next) = -1;
+                  INSN_CODE (insn) = -1;
+                }
+            }
+        }
+    }
+}
+
+
+/* Helper for `avr_compare_elim':  The state of the condition code as
+   tracked by `avr_notice_update_cc', together with the conditions that
+   can use the flags without the compare insn being repeated.  */
+
+enum
+  {
+    AVR_CC_SIGN = 1,
+    AVR_CC_EQ   = 2,
+    AVR_CC_ALL  = AVR_CC_SIGN | AVR_CC_EQ
+  };
+
+typedef struct
+{
+  CC_STATUS cc;
+  int cls;
+} avr_cc_state;
+
+typedef struct
+{
+  /* Meet of the states at the jumps seen so far that target the label.  */
+  avr_cc_state state;
+
+  /* Number of such jumps.  */
+  int n_jumps;
+} avr_cc_label;
+
+
+/* Map the condition of a cc0 user to the class of conditions it belongs
+   to.  Compares are printed in a condition specific way for EQ / NE and
+   GE / LT, cf. `avr_out_compare' and `avr_out_tsthi'.  */
+
+static int
+avr_cc_class (RTX_CODE cond)
+{
+  switch (cond)
+    {
+    case EQ:
+    case NE:
+      return AVR_CC_EQ;
+
+    case GE:
+    case LT:
+      return AVR_CC_SIGN;
+
+    default:
+      return AVR_CC_ALL;
+    }
+}
+
+
+static void
+avr_cc_state_init (avr_cc_state *s)
+{
+  s->cc.flags = 0;
+  s->cc.value1 = NULL_RTX;
+  s->cc.value2 = NULL_RTX;
+  s->cls = 0;
+}
+
+
+static bool
+avr_cc_state_equal_p (const avr_cc_state *a, const avr_cc_state *b)
+{
+  return (a->cc.flags == b->cc.flags
+          && a->cls == b->cls
+          && rtx_equal_p (a->cc.value1, b->cc.value1)
+          && rtx_equal_p (a->cc.value2, b->cc.value2));
+}
+
+
+/* Set *A to the state that holds on both paths with states *A and *B.  */
+
+static void
+avr_cc_state_meet (avr_cc_state *a, const avr_cc_state *b)
+{
+  if (!avr_cc_state_equal_p (a, b))
+    avr_cc_state_init (a);
+}
+
+
+/* Update state *S for the effect of INSN on the condition code.  */
+
+static void
+avr_cc_state_update (avr_cc_state *s, rtx_insn *insn)
+{
+  CC_STATUS saved = cc_status;
+  rtx set;
+
+  if (recog_memoized (insn) < 0)
+    {
+      /* Inline asm, or a CLOBBER which might kill a value of S.  */
+
+      if (GET_CODE (PATTERN (insn)) != USE)
+        avr_cc_state_init (s);
+      return;
+    }
+
+  cc_status = s->cc;
+  avr_notice_update_cc (PATTERN (insn), insn);
+
+  if (!cc_status.value1 && !cc_status.value2)
+    avr_cc_state_init (s);
+  else
+    {
+      set = single_set (insn);
+
+      if (set && SET_DEST (set) == cc0_rtx)
+        s->cls = avr_cc_class (compare_condition (insn));
+      else if (cc_status.flags != s->cc.flags
+               || cc_status.value1 != s->cc.value1
+               || cc_status.value2 != s->cc.value2)
+        {
+          /* Arithmetic that sets the flags:  `final' will not know about
+             CC_NO_OVERFLOW etc. after a label, hence only use Z.  */
+
+          s->cls = AVR_CC_EQ;
+        }
+
+      s->cc = cc_status;
+    }
+
+  cc_status = saved;
+}
+
+
+/* Return true if INSN is a compare of a value that state S knows about.
+   The values are matched like `final' does it:  As long as S is also the
+   state that `final' has, it will ignore INSN and use the flags of S.  */
+
+static bool
+avr_compare_known_p (rtx_insn *insn, const avr_cc_state *s)
+{
+  rtx set = single_set (insn);
+  rtx src1, src2 = NULL_RTX;
+  const CC_STATUS *cc = &s->cc;
+
+  if (!set
+      || SET_DEST (set) != cc0_rtx
+      || FIND_REG_INC_NOTE (insn, NULL_RTX)
+      || volatile_refs_p (PATTERN (insn)))
+    return false;
+
+  src1 = SET_SRC (set);
+
+  if (GET_CODE (src1) == COMPARE
+      && XEXP (src1, 1) == const0_rtx)
+    src2 = XEXP (src1, 0);
 
-  target = XEXP (XEXP (ifelse1, 1), 0);
-  cond = XEXP (ifelse1, 0);
-  jump = emit_jump_insn_after (gen_branch_unspec (target, cond), insn1);
+  return ((cc->value1 && rtx_equal_p (src1, cc->value1))
+          || (cc->value2 && rtx_equal_p (src1, cc->value2))
+          || (src2 && cc->value1 && rtx_equal_p (src2, cc->value1))
+          || (src2 && cc->value2 && rtx_equal_p (src2, cc->value2)));
+}
 
-  JUMP_LABEL (jump) = JUMP_LABEL (branch1);
 
-  target = XEXP (XEXP (ifelse2, 1), 0);
-  cond = gen_rtx_fmt_ee (code, VOIDmode, cc0_rtx, const0_rtx);
-  jump = emit_jump_insn_after (gen_branch_unspec (target, cond), insn2);
+/* Return true if INSN is a compare whose flags are provided by state S.  */
 
-  JUMP_LABEL (jump) = JUMP_LABEL (branch2);
+static bool
+avr_compare_redundant_p (rtx_insn *insn, const avr_cc_state *s)
+{
+  int cls;
 
-  /* The comparisons in insn1 and insn2 are exactly the same;
-     insn2 is superfluous so delete it.  */
+  if (!avr_compare_known_p (insn, s)
+      || side_effects_p (SET_SRC (single_set (insn))))
+    return false;
 
-  delete_insn (insn2);
-  delete_insn (branch1);
-  delete_insn (branch2);
+  cls = avr_cc_class (compare_condition (insn));
 
-  return true;
+  return (s->cls & cls) == cls;
 }
 
 
-/* Implement `TARGET_MACHINE_DEPENDENT_REORG'.  */
-/* Optimize conditional jumps.  */
+/* Worker for the "avr-compare-elim" pass.
+
+   `final' deletes a compare when the flags it would set are already
+   known from the preceding SUB, AND, TST etc., but it forgets about the
+   flags at each label and after each branch.  Hence track the condition
+   code across basic blocks:  The state at a label is the meet of the
+   states of the fall-through path and of all jumps that target the label,
+   provided all these jumps have been seen; labels reached by backward
+   jumps, jump tables or computed jumps start with an unknown state.
+   Compares after a label or branch whose flags are known are deleted.  */
 
 static void
-avr_reorg (void)
+avr_compare_elim (void)
 {
-  rtx_insn *insn = get_insns();
+  int first = get_first_label_num ();
+  avr_cc_label *labels = XCNEWVEC (avr_cc_label, max_label_num () - first);
+  avr_cc_state s, old;
+  bool fallthru = true, crossed = false;
+  int n_deleted = 0;
+  rtx_insn *insn, *next;
 
-  for (insn = next_real_insn (insn); insn; insn = next_real_insn (insn))
+  /* We rely on LABEL_NUSES being exact.  */
+
+  rebuild_jump_labels (get_insns ());
+
+  avr_cc_state_init (&s);
+
+  for (insn = get_insns (); insn; insn = next)
     {
-      rtx pattern = avr_compare_pattern (insn);
+      next = NEXT_INSN (insn);
 
-      if (!pattern)
-        continue;
+      if (LABEL_P (insn))
+        {
+          avr_cc_label *lab = &labels[CODE_LABEL_NUMBER (insn) - first];
+
+          if (LABEL_PRESERVE_P (insn)
+              || lab->n_jumps != LABEL_NUSES (insn))
+            avr_cc_state_init (&s);
+          else if (!fallthru)
+            s = lab->state;
+          else if (lab->n_jumps)
+            avr_cc_state_meet (&s, &lab->state);
+
+          fallthru = true;
+          crossed = s.cls != 0;
+          continue;
+        }
 
-      if (optimize
-          && avr_reorg_remove_redundant_compare (insn))
+      if (BARRIER_P (insn))
         {
+          fallthru = false;
+          avr_cc_state_init (&s);
           continue;
         }
 
-      if (compare_diff_p (insn))
-	{
-          /* Now we work under compare insn with difficult branch.  */
+      if (!NONDEBUG_INSN_P (insn))
+        continue;
 
-          rtx next = next_real_insn (insn);
-          rtx pat = PATTERN (next);
+      /* Compares with flags known from within the same basic block are
+         handled by `final'.  It ignores them even if the flags don't
+         serve their condition, e.g. a TST after a SUB, hence the flags
+         are still the ones described by S.  */
 
-          pattern = SET_SRC (pattern);
+      if (!crossed
+          && avr_compare_known_p (insn, &s))
+        continue;
 
-          if (true_regnum (XEXP (pattern, 0)) >= 0
-              && true_regnum (XEXP (pattern, 1)) >= 0)
-            {
-              rtx x = XEXP (pattern, 0);
-              rtx src = SET_SRC (pat);
-              rtx t = XEXP (src,0);
-              PUT_CODE (t, swap_condition (GET_CODE (t)));
-              XEXP (pattern, 0) = XEXP (pattern, 1);
-              XEXP (pattern, 1) = x;
-              INSN_CODE (next) = -1;
-            }
-          else if (true_regnum (XEXP (pattern, 0)) >= 0
-                   && XEXP (pattern, 1) == const0_rtx)
-            {
-              /* This is a tst insn, we can reverse it.  */
-              rtx src = SET_SRC (pat);
-              rtx t = XEXP (src,0);
+      if (crossed
+          && avr_compare_redundant_p (insn, &s))
+        {
+          if (dump_file)
+            fprintf (dump_file, ";; deleting redundant compare insn %d\n",
+                     INSN_UID (insn));
 
-              PUT_CODE (t, swap_condition (GET_CODE (t)));
-              XEXP (pattern, 1) = XEXP (pattern, 0);
-              XEXP (pattern, 0) = const0_rtx;
-              INSN_CODE (next) = -1;
-              INSN_CODE (insn) = -1;
-            }
-          else if (true_regnum (XEXP (pattern, 0)) >= 0
-                   && CONST_INT_P (XEXP (pattern, 1)))
-            {
-              rtx x = XEXP (pattern, 1);
-              rtx src = SET_SRC (pat);
-              rtx t = XEXP (src,0);
-              machine_mode mode = GET_MODE (XEXP (pattern, 0));
+          delete_insn (insn);
+          n_deleted++;
+          continue;
+        }
 
-              if (avr_simplify_comparison_p (mode, GET_CODE (t), x))
-                {
-                  XEXP (pattern, 1) = gen_int_mode (INTVAL (x) + 1, mode);
-                  PUT_CODE (t, avr_normalize_condition (GET_CODE (t)));
-                  INSN_CODE (next) = -1;
-                  INSN_CODE (insn) = -1;
-                }
-            }
+      if (JUMP_P (insn)
+          && SET == GET_CODE (PATTERN (insn)))
+        {
+          /* The branches don't change SREG.  Their "cc" attribute only
+             tells `final' to forget the flags.  Hence the flags are
+             known in the fall-through block and at the target.  */
+
+          crossed = s.cls != 0;
+        }
+      else
+        {
+          old = s;
+          avr_cc_state_update (&s, insn);
+
+          if (!avr_cc_state_equal_p (&old, &s))
+            crossed = false;
+        }
+
+      if (JUMP_P (insn)
+          && JUMP_LABEL (insn)
+          && LABEL_P (JUMP_LABEL (insn)))
+        {
+          avr_cc_label *lab
+            = &labels[CODE_LABEL_NUMBER (JUMP_LABEL (insn)) - first];
+
+          if (lab->n_jumps++ == 0)
+            lab->state = s;
+          else
+            avr_cc_state_meet (&lab->state, &s);
         }
     }
+
+  if (dump_file)
+    fprintf (dump_file, ";; %d redundant compare%s deleted\n",
+             n_deleted, n_deleted == 1 ? "" : "s");
+
+  XDELETEVEC (labels);
 }
 
 /* Returns register number for function return value.*/
@@ -12945,6 +15521,148 @@ avr_out_sbxx_branch (rtx_insn *insn, rtx operands[])
   return "";
 }
 
+/* Output insn "*skip_mov<mode>", i.e. the conditional move
+
+      if (XOP[1]) XOP[0] = XOP[4]
+
+   where XOP[1] is EQ or NE and compares XOP[2] against XOP[3].  XOP[2] is
+   a QImode register or a single bit of a register or of a low I/O
+   register as ZERO_EXTRACT.  The move is skipped if XOP[1] is false.
+   Return "".
+
+   PLEN == NULL:  Output instructions.
+   PLEN != NULL:  Set *PLEN to the length (in words) of the sequence.
+                  Don't output anything.  */
+
+const char*
+avr_out_skip_mov (rtx_insn *insn, rtx *xop, int *plen)
+{
+  /* Skip the move if this condition holds.  */
+  enum rtx_code skip = reverse_condition (GET_CODE (xop[1]));
+  rtx op[3], mov[2];
+  int len_mov;
+
+  if (plen)
+    *plen = 0;
+
+  if (ZERO_EXTRACT == GET_CODE (xop[2]))
+    {
+      op[1] = XEXP (xop[2], 0);
+      op[2] = XEXP (xop[2], 2);
+
+      if (MEM_P (op[1]))
+        {
+          op[1] = XEXP (op[1], 0);
+          avr_asm_len (skip == EQ ? "sbic %i1,%2" : "sbis %i1,%2",
+                       op, plen, 1);
+        }
+      else
+        avr_asm_len (skip == EQ ? "sbrc %T1%T2" : "sbrs %T1%T2",
+                     op, plen, 1);
+    }
+  else
+    {
+      /* CPSE can only skip if equal.  */
+
+      gcc_assert (skip == EQ);
+
+      op[1] = xop[2];
+      op[2] = xop[3] == CONST0_RTX (GET_MODE (xop[2])) ? zero_reg_rtx : xop[3];
+      avr_asm_len ("cpse %1,%2", op, plen, 1);
+    }
+
+  mov[0] = xop[0];
+  mov[1] = xop[4];
+  output_movqi (insn, mov, plen ? &len_mov : NULL);
+
+  if (plen)
+    *plen += len_mov;
+
+  return "";
+}
+
+
+/* Output the decrement and branch of insns "doloop_end_qi" and
+   "doloop_end_hi" for a loop counter in a register.
+
+   Operand 0: the loop counter.
+   Operand 1: label to jump to if the counter is not 0 after decrement.  */
+
+const char*
+avr_out_doloop_end (rtx_insn *insn, rtx *op)
+{
+  /* Words left for the branch.  */
+  int len = get_attr_length (insn);
+
+  if (QImode == GET_MODE (op[0]))
+    {
+      avr_asm_len ("dec %0", op, NULL, 1);
+      len -= 1;
+    }
+  else if (which_alternative == 0)
+    {
+      avr_asm_len ("sbiw %0,1", op, NULL, 1);
+      len -= 1;
+    }
+  else
+    {
+      avr_asm_len ("subi %A0,1" CR_TAB
+                   "sbci %B0,0", op, NULL, 2);
+      len -= 2;
+    }
+
+  return len == 1
+    ? "brne %x1"
+    : len == 2
+    ? "breq .+2" CR_TAB "rjmp %x1"
+    : "breq .+4" CR_TAB "jmp %x1";
+}
+
+
+/* Implement `TARGET_CAN_USE_DOLOOP_P'.  */
+
+static bool
+avr_can_use_doloop_p (const widest_int &iterations ATTRIBUTE_UNUSED,
+                      const widest_int &iterations_max,
+                      unsigned int loop_depth,
+                      bool entered_at_top ATTRIBUTE_UNUSED)
+{
+  /* Without a bound we cannot pick the counter mode.  Outer loops would
+     tie up a register during all of the inner loop.  */
+
+  return (iterations_max != 0
+          && loop_depth <= 1);
+}
+
+
+/* Used by expander "doloop_end":  Return true if a loop counter of mode
+   MODE shall be used for the loop that starts at LABEL.  The doloop pass
+   tries the mode of the induction variable first, and then QImode
+   (word_mode) provided the number of iterations fits.  Hence refuse
+   HImode if a QImode counter will do.  */
+
+bool
+avr_doloop_mode_p (machine_mode mode, rtx label)
+{
+  basic_block bb = LABEL_P (label) ? BLOCK_FOR_INSN (label) : NULL;
+  widest_int iterations_max;
+
+  switch (mode)
+    {
+    case QImode:
+      return true;
+
+    case HImode:
+      return (!bb
+              || !bb->loop_father
+              || !get_max_loop_iterations (bb->loop_father, &iterations_max)
+              || wi::gtu_p (iterations_max, 0xff));
+
+    default:
+      return false;
+    }
+}
+
 /* Worker function for `TARGET_ASM_CONSTRUCTOR'.  */
 
 static void
@@ -13452,6 +16170,163 @@ avr_emit2_fix_outputs (rtx (*gen)(rtx,rtx), rtx *op,
   return avr_move_fixed_operands (op, hreg, opmask);
 }
 
+
+/* Worker function for the mul<mode>3 expanders on devices without MUL.
+   Multiply OP[1] by the constant OP[2] and store the result in OP[0] by
+   means of shifts, additions and subtractions as given by the canonical
+   signed digit (CSD) representation of OP[2]:  Each digit is one of -1, 0
+   or +1, and no two adjacent digits are non-zero.  The digits are worked
+   off Horner-like from the most significant one so that each shift is
+   as short as possible; the shifts themselves are printed by the usual
+   ashl<mode>3 output functions like ashlhi3_out.
+
+   Return true if the sequence has been emitted.  Return false and don't
+   emit anything if the sequence is more expensive than the libgcc call
+   it replaces, i.e. more than what the call and its argument moves cost
+   with -Os, resp. more than about 4 cycles per bit of MODE (the libgcc
+   shift-add loops need 6 and more) when optimizing for speed.  */
+
+bool
+avr_emit_mul_csd (machine_mode mode, rtx *op)
+{
+  int n_bits = GET_MODE_BITSIZE (mode);
+  unsigned HOST_WIDE_INT val = UINTVAL (op[2]) & GET_MODE_MASK (mode);
+  bool speed = optimize_insn_for_speed_p ();
+  signed char digit[1 + HOST_BITS_PER_WIDE_INT];
+  int i, hi = -1, cost, limit;
+  rtx acc;
+  rtx_insn *seq;
+
+  gcc_assert (!AVR_HAVE_MUL
+              && n_bits < HOST_BITS_PER_WIDE_INT);
+
+  /* Get the CSD representation of VAL.  Digits at and above N_BITS are
+     multiples of 2^N_BITS and don't contribute to the result.  */
+
+  for (i = 0; val != 0; i++)
+    {
+      digit[i] = (val & 1) ? 2 - (int) (val & 3) : 0;
+      val = (val - digit[i]) >> 1;
+
+      if (digit[i] && i < n_bits)
+        hi = i;
+    }
+
+  start_sequence ();
+
+  if (hi < 0)
+    acc = CONST0_RTX (mode);
+  else
+    {
+      int prev = hi;
+
+      acc = digit[hi] > 0
+        ? op[1]
+        : expand_simple_unop (mode, NEG, op[1], NULL_RTX, 0);
+
+      for (i = hi - 1; i >= 0; i--)
+        if (digit[i])
+          {
+            acc = expand_simple_binop (mode, ASHIFT, acc, GEN_INT (prev - i),
+                                       NULL_RTX, 0, OPTAB_LIB_WIDEN);
+            acc = expand_simple_binop (mode, digit[i] > 0 ? PLUS : MINUS,
+                                       acc, op[1], NULL_RTX, 0,
+                                       OPTAB_LIB_WIDEN);
+            prev = i;
+          }
+
+      if (prev > 0)
+        acc = expand_simple_binop (mode, ASHIFT, acc, GEN_INT (prev),
+                                   NULL_RTX, 0, OPTAB_LIB_WIDEN);
+    }
+
+  emit_move_insn (op[0], acc);
+
+  seq = get_insns ();
+  end_sequence ();
+
+  limit = speed
+    ? COSTS_N_INSNS (4 * n_bits)
+    : COSTS_N_INSNS ((AVR_HAVE_JMP_CALL ? 2 : 1) + 2 * GET_MODE_SIZE (mode));
+
+  cost = seq_cost (seq, speed);
+
+  if (avr_log.rtx_costs)
+    avr_edump ("\n%?: %m * %r: CSD cost %d, limit %d\n", mode, op[2],
+               cost, limit);
+
+  if (cost > limit)
+    return false;
+
+  emit_insn (seq);
+
+  return true;
+}
+
+
+/* Worker function for the fixed-point <code><mode>3 division expanders.
+   Divide OP[1] by the compile time constant OP[2] and store the result in
+   OP[0]:  The integer representation of OP[1] shifted left by FBIT fits
+   an integer mode of twice the size, and dividing it by the integer
+   representation of OP[2] is a plain integer division by a constant.
+   expand_divmod turns that into a multiplication by the reciprocal, i.e.
+   a multiply-high and some shifts and additions.  The quotient is
+   truncated towards zero like in fixed-value.c.  CODE is DIV or UDIV.
+
+   Return true if the sequence has been emitted.  Return false and don't
+   emit anything if OP[2] is not a constant or zero, if the device has no
+   MUL, if we optimize for size, for the 32-bit modes (the division would
+   be 64 bits wide), or if expand_divmod resorts to a library call.  */
+
+bool
+avr_emit_div_fixed_const (enum rtx_code code, rtx *op)
+{
+  machine_mode mode = GET_MODE (op[0]);
+  machine_mode imode = int_mode_for_mode (mode);
+  machine_mode wmode;
+  bool unsigned_p = UDIV == code;
+  rtx x, c, q;
+  rtx_insn *seq, *insn;
+
+  if (!CONST_FIXED_P (op[2])
+      || !AVR_HAVE_MUL
+      || !optimize_insn_for_speed_p ()
+      || GET_MODE_SIZE (mode) > 2)
+    return false;
+
+  c = avr_to_int_mode (op[2]);
+
+  if (const0_rtx == c)
+    return false;
+
+  wmode = mode_for_size (2 * GET_MODE_BITSIZE (imode), MODE_INT, 0);
+
+  start_sequence ();
+
+  x = convert_to_mode (wmode, avr_to_int_mode (op[1]), unsigned_p);
+  x = expand_simple_binop (wmode, ASHIFT, x, GEN_INT (GET_MODE_FBIT (mode)),
+                           NULL_RTX, unsigned_p, OPTAB_LIB_WIDEN);
+  c = convert_modes (wmode, imode, c, unsigned_p);
+  q = expand_divmod (0, TRUNC_DIV_EXPR, wmode, x, c, NULL_RTX, unsigned_p);
+  q = convert_to_mode (imode, q, unsigned_p);
+  emit_move_insn (op[0], gen_lowpart (mode, force_reg (imode, q)));
+
+  seq = get_insns ();
+  end_sequence ();
+
+  for (insn = seq; insn; insn = NEXT_INSN (insn))
+    if (CALL_P (insn))
+      return false;
+
+  if (avr_log.rtx_costs)
+    avr_edump ("\n%?: %m / %r: by reciprocal\n", mode, op[2]);
+
+  emit_insn (seq);
+
+  return true;
+}
+
+
 /* Worker function for movmemhi expander.
    XOP[0]  Destination as MEM:BLK
    XOP[1]  Source      "     "
@@ -14161,6 +17036,24 @@ avr_init_builtins (void)
                                 const_memx_ptr_type_node,
                                 NULL);
 
+#define INTN_FTYPE_INTN(n, m)                                           \
+  tree int##n##_ftype_int##n                                            \
+    = build_function_type_list (int##m##_type_node,                     \
+                                int##m##_type_node, NULL);              \
+  tree int##n##_ftype_int##n##_int##n                                   \
+    = build_function_type_list (int##m##_type_node, int##m##_type_node, \
+                                int##m##_type_node, NULL);              \
+  tree uint##n##_ftype_uint##n##_uint##n                                \
+    = build_function_type_list (unsigned_int##m##_type_node,            \
+                                unsigned_int##m##_type_node,            \
+                                unsigned_int##m##_type_node, NULL)
+
+  /* For the saturated integer arithmetic.  */
+
+  INTN_FTYPE_INTN (8, QI);
+  INTN_FTYPE_INTN (16, HI);
+  INTN_FTYPE_INTN (32, SI);
+
 #define ITYP(T)                                                         \
   lang_hooks.types.type_for_size (TYPE_PRECISION (T), TYPE_UNSIGNED (T))
 
@@ -14501,10 +17394,51 @@ avr_fold_absfx (tree tval)
 }
 
 
+/* Helper for `avr_fold_builtin' that folds the saturated integer
+   built-ins like __builtin_avr_ssadd16 if all arguments are constants.
+   CODE is the rtx code of the insn the built-in maps to.  */
+
+static tree
+avr_fold_sat (enum rtx_code code, tree val_type, int n_args, tree *arg)
+{
+  int i, prec = TYPE_PRECISION (val_type);
+  HOST_WIDE_INT lo, hi, val[2] = { 0, 0 }, r;
+
+  for (i = 0; i < n_args; i++)
+    {
+      if (TREE_CODE (arg[i]) != INTEGER_CST
+          || !tree_fits_shwi_p (arg[i]))
+        return NULL_TREE;
+
+      val[i] = tree_to_shwi (arg[i]);
+    }
+
+  lo = TYPE_UNSIGNED (val_type) ? 0 : -((HOST_WIDE_INT) 1 << (prec - 1));
+  hi = TYPE_UNSIGNED (val_type)
+    ? ((HOST_WIDE_INT) 1 << prec) - 1
+    : ((HOST_WIDE_INT) 1 << (prec - 1)) - 1;
+
+  switch (code)
+    {
+    case SS_PLUS:
+    case US_PLUS:  r = val[0] + val[1]; break;
+    case SS_MINUS:
+    case US_MINUS: r = val[0] - val[1]; break;
+    case SS_NEG:   r = -val[0]; break;
+    case SS_ABS:   r = val[0] < 0 ? -val[0] : val[0]; break;
+
+    default:
+      gcc_unreachable ();
+    }
+
+  return build_int_cst (val_type, MAX (lo, MIN (r, hi)));
+}
+
+
 /* Implement `TARGET_FOLD_BUILTIN'.  */
 
 static tree
-avr_fold_builtin (tree fndecl, int n_args ATTRIBUTE_UNUSED, tree *arg,
+avr_fold_builtin (tree fndecl, int n_args, tree *arg,
                   bool ignore ATTRIBUTE_UNUSED)
 {
   unsigned int fcode = DECL_FUNCTION_CODE (fndecl);
@@ -14524,6 +17458,28 @@ avr_fold_builtin (tree fndecl, int n_args ATTRIBUTE_UNUSED, tree *arg,
                             build_int_cst (val_type, 4));
       }
 
+    case AVR_BUILTIN_SSADD8:  case AVR_BUILTIN_USADD8:
+    case AVR_BUILTIN_SSADD16: case AVR_BUILTIN_USADD16:
+    case AVR_BUILTIN_SSADD32: case AVR_BUILTIN_USADD32:
+      return avr_fold_sat (TYPE_UNSIGNED (val_type) ? US_PLUS : SS_PLUS,
+                           val_type, n_args, arg);
+
+    case AVR_BUILTIN_SSSUB8:  case AVR_BUILTIN_USSUB8:
+    case AVR_BUILTIN_SSSUB16: case AVR_BUILTIN_USSUB16:
+    case AVR_BUILTIN_SSSUB32: case AVR_BUILTIN_USSUB32:
+      return avr_fold_sat (TYPE_UNSIGNED (val_type) ? US_MINUS : SS_MINUS,
+                           val_type, n_args, arg);
+
+    case AVR_BUILTIN_SSNEG8:
+    case AVR_BUILTIN_SSNEG16:
+    case AVR_BUILTIN_SSNEG32:
+      return avr_fold_sat (SS_NEG, val_type, n_args, arg);
+
+    case AVR_BUILTIN_SSABS8:
+    case AVR_BUILTIN_SSABS16:
+    case AVR_BUILTIN_SSABS32:
+      return avr_fold_sat (SS_ABS, val_type, n_args, arg);
+
     case AVR_BUILTIN_ABSHR:
     case AVR_BUILTIN_ABSR:
     case AVR_BUILTIN_ABSLR:
@@ -14753,6 +17709,8 @@ avr_fold_builtin (tree fndecl, int n_args ATTRIBUTE_UNUSED, tree *arg,
 #define TARGET_ADDRESS_COST avr_address_cost
 #undef  TARGET_MACHINE_DEPENDENT_REORG
 #define TARGET_MACHINE_DEPENDENT_REORG avr_reorg
+#undef  TARGET_CAN_USE_DOLOOP_P
+#define TARGET_CAN_USE_DOLOOP_P avr_can_use_doloop_p
 #undef  TARGET_FUNCTION_ARG
 #define TARGET_FUNCTION_ARG avr_function_arg
 #undef  TARGET_FUNCTION_ARG_ADVANCE
@@ -14864,6 +17822,14 @@ avr_fold_builtin (tree fndecl, int n_args ATTRIBUTE_UNUSED, tree *arg,
 #define TARGET_USE_BY_PIECES_INFRASTRUCTURE_P \
   avr_use_by_pieces_infrastructure_p
 
+/* The call insns don't clobber any non-fixed register, and neither do the
+   stubs the linker might insert for EIND.  Registers changed by libgcc
+   code that is entered by JMP, like __epilogue_restores__, are clobbered
+   by the respective insn.  */
+
+#undef  TARGET_CALL_FUSAGE_CONTAINS_NON_CALLEE_CLOBBERS
+#define TARGET_CALL_FUSAGE_CONTAINS_NON_CALLEE_CLOBBERS true
+
 struct gcc_target targetm = TARGET_INITIALIZER;
 
 
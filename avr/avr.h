@@ -106,6 +106,11 @@ FIXME: DRIVER_SELF_SPECS has changed.
 #define AVR_2_BYTE_PC (!AVR_HAVE_EIJMP_EICALL)
 #define AVR_3_BYTE_PC (AVR_HAVE_EIJMP_EICALL)
 
+/* Values of -mshift-ladder=  */
+#define AVR_SHIFT_LADDER_LOOP   0
+#define AVR_SHIFT_LADDER_AUTO   1
+#define AVR_SHIFT_LADDER_ALWAYS 2
+
 #define AVR_XMEGA (avr_arch->xmega_p)
 #define AVR_TINY  (avr_arch->tiny_p)
 #define AVR_XMEGA3 (avr_arch == &avr_arch_types[ARCH_AVRXMEGA3])
@@ -599,6 +604,15 @@ struct GTY(()) machine_function
   /* 'true' if a callee might be tail called */
   int sibcall_fails;
 
+  /* Mask of AVR_ISR_* registers that an ISR need not save because the
+     function doesn't use them, see avr_isr_scan_saves.  */
+  int isr_skip_saves;
+
+  /* Registers that the calls of an ISR might clobber, and whether the
+     set has been computed, see avr_call_clobbered_regs.  */
+  HARD_REG_SET call_clobbered_regs;
+  int call_clobbered_regs_valid;
+
   /* 'true' if the above is_foo predicates are sanity-checked to avoid
      multiple diagnose for the same function.  */
   int attributes_checked_p;
@@ -35,6 +35,14 @@ along with GCC; see the file COPYING3.  If not see
 #define STARTFILE_SPEC                          \
   " %(avrlibc_startfile) "
 
+// Defaults for devices from the device database, see specs.h.
+
+#undef  EXTRA_SPECS
+#define EXTRA_SPECS                                             \
+  AVR_EXTRA_SPECS                                               \
+  { "avrlibc_startfile", "%{mdevice=*:crt%*.o%s}" },            \
+  { "avrlibc_devicelib", "%{!nodevicelib:%{mdevice=*:-l%*}}" },
+
 #undef  LINK_GCC_C_SEQUENCE_SPEC
 #define LINK_GCC_C_SEQUENCE_SPEC \
   "--start-group %G %L --end-group"
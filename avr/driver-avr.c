@@ -23,6 +23,8 @@ along with GCC; see the file COPYING3.  If not see
 #include "coretypes.h"
 #include "diagnostic.h"
 #include "tm.h"
+#include "avr-devdb.h"
+#include <sys/time.h>
 
 // Remove -nodevicelib from the command line if not needed
 #define X_NODEVLIB "%<nodevicelib"
@@ -31,6 +33,18 @@ static const char dir_separator_str[] = { DIR_SEPARATOR, 0 };
 
 std::string PackPrefix;
 
+/* Start of the device-specs resolution for -mtime-report, i.e. of the
+   evaluation of DRIVER_SELF_SPECS.  */
+static long long specs_start_usec = -1;
+
+static long long
+avr_time_usec (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
 static std::string
 convert_white_space (const char *orig)
 {
@@ -74,6 +88,8 @@ tr (char *string, int c1, int c2)
 const char*
 avr_device_pack (int argc, const char **argv)
 {
+  specs_start_usec = avr_time_usec ();
+
   switch (argc)
     {
     case 0:
@@ -99,6 +115,80 @@ avr_device_pack (int argc, const char **argv)
   return concat("%<mdfp=* -mpack-dir=", PackPrefix.c_str(), " ", NULL);
 }
 
+/* Compose the options that the device-specs file of MCU would supply,
+   see gen-avr-mmcu-specs.c:print_mcu.  The subspecs for the assembler and
+   the linker default to take them from these options, see specs.h.  */
+
+static std::string
+avr_devdb_spec (const avr_devdb_mcu_t *mcu)
+{
+  const avr_arch_t *arch = &avr_arch_types[mcu->arch_id];
+  bool absdata = 0 != (mcu->dev_attribute & AVR_ISA_LDS);
+  bool errata_skip = 0 != (mcu->dev_attribute & AVR_ERRATA_SKIP);
+  bool rmw = 0 != (mcu->dev_attribute & AVR_ISA_RMW);
+  bool sp8 = 0 != (mcu->dev_attribute & AVR_SHORT_SP);
+  bool rcall = 0 != (mcu->dev_attribute & AVR_ISA_RCALL);
+  char buf[200];
+
+  std::string spec = std::string ("%<mmcu=* -mmcu=") + arch->name
+    + " -mdevice=" + mcu->name
+    + (ARCH_AVR1 == mcu->arch_id ? " %<mconst-data-in-progmem" : "")
+    + (rcall ? " -mshort-calls" : " %<mshort-calls")
+    + (sp8 ? " -msp8" : " %<msp8");
+
+  snprintf (buf, sizeof (buf), " %%{!mn-flash=*:-mn-flash=%d}", mcu->n_flash);
+  spec += buf;
+
+  spec += rmw ? " %{!mno-rmw:-mrmw}" : "";
+  spec += errata_skip
+    ? " %{!mno-skip-bug:-mskip-bug}"
+    : " %{!mskip-bug:-mno-skip-bug}";
+  spec += absdata ? " %{!mno-absdata:-mabsdata}" : "";
+
+  if (mcu->non_bit_addressable_registers_mask)
+    {
+      snprintf (buf, sizeof (buf),
+                " -mnon-bit-addressable-registers-mask=%#x",
+                mcu->non_bit_addressable_registers_mask);
+      spec += buf;
+    }
+
+  spec += std::string (" -D") + mcu->macro
+    + " -D__AVR_DEVICE_NAME__=" + mcu->name;
+
+  if (mcu->data_section_start != arch->default_data_section_start)
+    {
+      snprintf (buf, sizeof (buf), " -Wl,-Tdata,0x%lX",
+                0x800000UL + mcu->data_section_start);
+      spec += buf;
+    }
+
+  if (mcu->text_section_start != 0x0)
+    {
+      snprintf (buf, sizeof (buf), " -Wl,-Ttext,0x%lX",
+                0UL + mcu->text_section_start);
+      spec += buf;
+    }
+
+  int wrap_k =
+    mcu->flash_size == 0x2000 ? 8
+    : mcu->flash_size == 0x4000 ? 16
+    : mcu->flash_size == 0x8000 ? 32
+    : mcu->flash_size == 0x10000 ? 64
+    : 0;
+
+  if (wrap_k == 8)
+    spec += " %{!mno-pmem-wrap-around:-Wl,--pmem-wrap-around=8k}";
+  else if (wrap_k > 8)
+    {
+      snprintf (buf, sizeof (buf),
+                " %%{mpmem-wrap-around:-Wl,--pmem-wrap-around=%dk}", wrap_k);
+      spec += buf;
+    }
+
+  return spec;
+}
+
 /* Implement spec function `device-specs-file´.
 
    Validate mcu name given with -mmcu option. Compose
@@ -180,14 +270,36 @@ avr_devicespecs_file (int argc, const char **argv)
                             "include", NULL);
     }
 
-  return concat (PackOptions, " -specs=device-specs", dir_separator_str, "specs-",
-                 mmcu, "%s"
+  /* Hand the time spent so far to the compiler proper which reports it
+     along with its own startup times.  */
+  char TimeOption[64] = "";
+  if (specs_start_usec >= 0)
+    snprintf (TimeOption, sizeof (TimeOption),
+              " %%{mtime-report*:-mdriver-specs-time=%d}",
+              (int) (avr_time_usec () - specs_start_usec));
+
+  const char *SpecsOption = concat (" -specs=device-specs", dir_separator_str,
+                                   "specs-", mmcu, "%s", NULL);
+
+  /* Devices known to the device database next to the device-specs files
+     don't need their specs file to be searched for and parsed.  A DFP
+     brings its own specs files which take precedence, and -mno-device-db
+     falls back to the specs file.  */
+  avr_devdb_mcu_t dbmcu;
+  if (PackPrefix.empty()
+      && argc > 1
+      && avr_devdb_lookup (concat (argv[0], dir_separator_str,
+                                   AVR_DEVDB_FILE, NULL), mmcu, &dbmcu))
+    SpecsOption = concat (" %{mno-device-db:", SpecsOption, ";:",
+                          avr_devdb_spec (&dbmcu).c_str(), "}", NULL);
+
+  return concat (PackOptions, SpecsOption,
 #if defined (WITH_AVRLIBC)
                  " %{mmcu=avr*:" X_NODEVLIB "} %{!mmcu=*:" X_NODEVLIB "}",
 #else
                  " " X_NODEVLIB,
 #endif
-                 NULL);
+                 TimeOption, NULL);
 }
 
 const char*
@@ -26,6 +26,7 @@
 #define IN_GEN_AVR_MMCU_TEXI
 
 #include "avr-devices.c"
+#include "avr-devdb.h"
 
 // Get rid of "defaults.h".  We just need tm.h for `WITH_AVRLIBS' and
 // and `WITH_RTEMS'.  */
@@ -317,10 +318,125 @@ print_mcu (const avr_mcu_t *mcu)
 }
 
 
+static void
+put_word (FILE *f, unsigned int w)
+{
+  fputc (w & 0xff, f);
+  fputc ((w >> 8) & 0xff, f);
+  fputc ((w >> 16) & 0xff, f);
+  fputc ((w >> 24) & 0xff, f);
+}
+
+/* Append STR to the string table STRTAB of current size *LEN and
+   return its offset.  */
+
+static unsigned int
+add_string (char *strtab, unsigned int *len, const char *str)
+{
+  unsigned int offset = *len;
+
+  strcpy (strtab + offset, str);
+  *len += strlen (str) + 1;
+
+  return offset;
+}
+
+/* Write the device database, see avr-devdb.h.  Only proper devices are
+   recorded, core architectures like "avr5" are served by their specs
+   files.  */
+
+static void
+print_devdb (void)
+{
+  unsigned int n_mcus = 0, n_buckets = 1, strtab_size = 1;
+
+  for (const avr_mcu_t *mcu = avr_mcu_types; mcu->name; mcu++)
+    if (mcu->macro)
+      {
+        n_mcus++;
+        strtab_size += strlen (mcu->name) + 1 + strlen (mcu->macro) + 1;
+      }
+
+  // At most 50% load.
+
+  while (n_buckets < 2 * n_mcus)
+    n_buckets *= 2;
+
+  unsigned int *buckets = (unsigned int*) calloc (n_buckets, sizeof (unsigned));
+  unsigned int *records
+    = (unsigned int*) calloc (n_mcus * AVR_DEVDB_RECORD_WORDS, sizeof (unsigned));
+  char *strtab = (char*) calloc (strtab_size, 1);
+  unsigned int strtab_len = 1;
+  unsigned int i = 0;
+
+  if (!buckets || !records || !strtab)
+    exit (EXIT_FAILURE);
+
+  for (const avr_mcu_t *mcu = avr_mcu_types; mcu->name; mcu++)
+    {
+      if (!mcu->macro)
+        continue;
+
+      unsigned int *r = records + i * AVR_DEVDB_RECORD_WORDS;
+      unsigned int b = avr_devdb_hash (mcu->name) & (n_buckets - 1);
+
+      r[AVR_DEVDB_R_NAME] = add_string (strtab, &strtab_len, mcu->name);
+      r[AVR_DEVDB_R_MACRO] = add_string (strtab, &strtab_len, mcu->macro);
+      r[AVR_DEVDB_R_ARCH_ID] = mcu->arch_id;
+      r[AVR_DEVDB_R_DEV_ATTRIBUTE] = mcu->dev_attribute;
+      r[AVR_DEVDB_R_DATA_SECTION_START] = mcu->data_section_start;
+      r[AVR_DEVDB_R_TEXT_SECTION_START] = mcu->text_section_start;
+      r[AVR_DEVDB_R_NON_BIT_ADDRESSABLE_MASK]
+        = mcu->non_bit_addressable_registers_mask;
+      r[AVR_DEVDB_R_FLASH_SIZE] = mcu->flash_size;
+      r[AVR_DEVDB_R_N_FLASH] = 1 + (mcu->flash_size - 1) / 0x10000;
+
+      // Chain into the bucket.
+
+      r[AVR_DEVDB_R_NEXT] = buckets[b];
+      buckets[b] = ++i;
+    }
+
+  unsigned int strtab_offset
+    = 4 * (AVR_DEVDB_HEADER_WORDS + n_buckets
+           + n_mcus * AVR_DEVDB_RECORD_WORDS);
+
+  FILE *f = fopen (AVR_DEVDB_FILE, "wb");
+
+  if (!f)
+    exit (EXIT_FAILURE);
+
+  fwrite (AVR_DEVDB_MAGIC, 1, 8, f);
+  put_word (f, AVR_DEVDB_VERSION);
+  put_word (f, n_mcus);
+  put_word (f, n_buckets);
+  put_word (f, strtab_offset);
+  put_word (f, strtab_size);
+  put_word (f, strtab_offset + strtab_size);
+
+  for (i = 0; i < n_buckets; i++)
+    put_word (f, buckets[i]);
+
+  for (i = 0; i < n_mcus * AVR_DEVDB_RECORD_WORDS; i++)
+    put_word (f, records[i]);
+
+  fwrite (strtab, 1, strtab_size, f);
+
+  if (fclose (f) != 0)
+    exit (EXIT_FAILURE);
+
+  free (buckets);
+  free (records);
+  free (strtab);
+}
+
+
 int main (void)
 {
   for (const avr_mcu_t *mcu = avr_mcu_types; mcu->name; mcu++)
     print_mcu (mcu);
 
+  print_devdb ();
+
   return EXIT_SUCCESS;
 }
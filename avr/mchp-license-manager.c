@@ -156,6 +156,8 @@ HOST_WIDE_INT mchp_avr_license_valid = -1;
 
 #ifndef SKIP_LICENSE_MANAGER
 
+static const char dir_separator_str[] = { DIR_SEPARATOR, 0 };
+
 static char*
 get_license_manager_path (void)
 {
@@ -389,8 +391,12 @@ avr_get_license ()
     args[4] = date;
 #endif /* XCLM_FULL_CHECKOUT */
 
+    long long t_start = avr_time_usec ();
+    long long t_path, t_sha = 0, t_xclm = 0;
+
     /* Get a path to the license manager to try */
     exec = get_license_manager_path();
+    t_path = avr_time_usec ();
 
 #if defined(MCHP_DEBUG)
     fprintf (stderr, "exec is %s\n", exec);
@@ -428,8 +434,17 @@ avr_get_license ()
     /* Verify SHA sum and call xclm to determine the license */
     if (found_xclm && mchp_avr_license_valid==-1 && !TARGET_SKIP_LICENSE_CHECK)
       {
-        /* Verify that xclm executable is untampered */
-        xclm_tampered = mchp_sha256_validate(exec, (const unsigned char*)MCHP_XCLM_SHA256_DIGEST_QUOTED);
+        /* Verify that xclm executable is untampered.  A successful check
+           is remembered per user along with the inode, size, mtime and
+           ctime of xclm so that it isn't hashed for every compilation.  */
+        const char *cache_dir = avr_user_cache_directory ();
+        char *cache_file = cache_dir
+          ? concat (cache_dir, dir_separator_str, "xclm-sha256", NULL) : NULL;
+        xclm_tampered = mchp_sha256_validate_cached(exec, (const unsigned char*)MCHP_XCLM_SHA256_DIGEST_QUOTED,
+                                                    cache_file);
+        free (cache_file);
+        t_sha = avr_time_usec ();
+
         if (xclm_tampered != 0)
           {
             /* Set free edition if the license manager SHA digest does not
@@ -457,8 +472,15 @@ avr_get_license ()
               {
                 mchp_avr_license_valid = WEXITSTATUS(status);
               }
+            t_xclm = avr_time_usec ();
           }
       }
+
+    if (avr_log.startup)
+      avr_edump ("license: find xclm %d us, SHA-256 check %d us, "
+                 "xclm %d us\n", (int) (t_path - t_start),
+                 t_sha ? (int) (t_sha - t_path) : 0,
+                 t_xclm ? (int) (t_xclm - t_sha) : 0);
   }
 #undef xstr
 #undef str
@@ -553,7 +575,9 @@ void avr_override_licensed_options (void)
   }
   else 
   {
+    avr_time_start (AVR_TIME_LICENSE_CHECK);
     mchp_avr_license_valid = avr_get_license ();
+    avr_time_stop (AVR_TIME_LICENSE_CHECK);
   }
 
   if ((mchp_avr_license_valid == AVR_VALID_STANDARD_LICENSE) ||
@@ -21,6 +21,9 @@ along with GCC; see the file COPYING3.  If not see
 
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "sha256.h"
 #include "mchp_sha.h"
 
@@ -67,3 +70,64 @@ int mchp_sha256_validate( const char *path, unsigned const char *sha2 )
    return strcmp( (char*)sha256hex ,(char*) sha2 );
 }
 
+
+/* Describe the identity of file PATH as seen by STAT together with the
+   expected digest in RECORD.  */
+static void mchp_sha256_stat_record( char *record, size_t size,
+                                     const char *path, const struct stat *st,
+                                     unsigned const char *sha2 )
+{
+   snprintf( record, size, "%s\t%lu\t%lu\t%lu\t%ld\t%ld\t%s",
+             path, (unsigned long) st->st_dev, (unsigned long) st->st_ino,
+             (unsigned long) st->st_size, (long) st->st_mtime,
+             (long) st->st_ctime, (const char *) sha2 );
+}
+
+int mchp_sha256_validate_cached( const char *path, unsigned const char *sha2,
+                                 const char *cache_file )
+{
+   int result;
+   struct stat st, st_after;
+   char record[MCHP_SHA_CACHE_RECORD_MAX], cached[MCHP_SHA_CACHE_RECORD_MAX];
+   FILE *f;
+
+   if( cache_file == NULL || stat( path, &st ) != 0 )
+      return mchp_sha256_validate( path, sha2 );
+
+   mchp_sha256_stat_record( record, sizeof( record ), path, &st, sha2 );
+
+   /* Cache hit: same file, unchanged since it was last verified */
+   if( ( f = fopen( cache_file, "r" ) ) != NULL )
+   {
+      char *line = fgets( cached, sizeof( cached ), f ) != NULL
+                   ? strtok( cached, "\n" ) : NULL;
+      int hit = line != NULL && strcmp( line, record ) == 0;
+      fclose( f );
+      if( hit )
+         return 0;
+   }
+
+   result = mchp_sha256_validate( path, sha2 );
+
+   /* Only remember a successful validation of a file that did not change
+      while it was hashed */
+   if( result == 0
+       && stat( path, &st_after ) == 0
+       && st_after.st_ino == st.st_ino
+       && st_after.st_size == st.st_size
+       && st_after.st_mtime == st.st_mtime
+       && st_after.st_ctime == st.st_ctime )
+   {
+      char tmp_file[MCHP_SHA_CACHE_RECORD_MAX];
+      snprintf( tmp_file, sizeof( tmp_file ), "%s.%ld.tmp", cache_file,
+                (long) getpid() );
+      if( ( f = fopen( tmp_file, "w" ) ) != NULL )
+      {
+         int ok = fprintf( f, "%s\n", record ) > 0;
+         if( fclose( f ) != 0 || !ok || rename( tmp_file, cache_file ) != 0 )
+            remove( tmp_file );
+      }
+   }
+
+   return result;
+}
@@ -54,4 +54,22 @@ int mchp_sha256( const char *path, unsigned char output[32] );
 */
 int mchp_sha256_validate( const char *path, unsigned const char *sha2);
 
+/* Maximum length of a validation cache entry (path, stat fields, digests) */
+#define MCHP_SHA_CACHE_RECORD_MAX 4096
+
+/* Function like mchp_sha256_validate but remembers a successful validation
+ * in a cache file together with the device, inode, size, mtime and ctime of
+ * the file.  The file is hashed again as soon as any of them changes.
+ * The entry holds no secret, so it is only as trustworthy as the cache
+ * file's permissions.
+ * Parameters :
+ *     - Absolute path to file
+ *     - Pre-calculated SHA256 digest of the file (null terminated)
+ *     - Path of the per-user cache file, NULL to disable caching
+ * Return value :
+ *     - 0 on match, non-zero on mis-match
+*/
+int mchp_sha256_validate_cached( const char *path, unsigned const char *sha2,
+                                 const char *cache_file );
+
 #endif
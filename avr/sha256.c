@@ -31,8 +31,36 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include "sha256.h"
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#define SHA256_USE_MMAP
+/* Files at least this large are hashed through mmap */
+#define SHA256_MMAP_THRESHOLD   (64 * 1024)
+#endif
+
+/*
+ * x86 backends need the target attribute and the SHA intrinsics (GCC 4.9,
+ * clang 3.4 and later)
+ */
+#if ( defined(__x86_64__) || defined(__i386__) ) && \
+    ( ( defined(__clang__) && \
+        ( __clang_major__ > 3 || \
+          ( __clang_major__ == 3 && __clang_minor__ >= 4 ) ) ) || \
+      ( !defined(__clang__) && defined(__GNUC__) && \
+        ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) ) )
+#define SHA256_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 
 /*
  * 32-bit integer manipulation macros (big endian)
@@ -93,7 +121,10 @@ void sha256_starts( sha256_context *ctx, int is224 )
     ctx->is224 = is224;
 }
 
-void sha256_process( sha256_context *ctx, const unsigned char data[64] )
+/*
+ * Portable reference implementation
+ */
+static void sha256_process_c( sha256_context *ctx, const unsigned char data[64] )
 {
     uint32_t temp1, temp2, W[64];
     uint32_t A, B, C, D, E, F, G, H;
@@ -224,6 +255,202 @@ void sha256_process( sha256_context *ctx, const unsigned char data[64] )
     ctx->state[7] += H;
 }
 
+static void sha256_blocks_c( sha256_context *ctx, const unsigned char *data,
+                             size_t blocks )
+{
+    while( blocks-- > 0 )
+    {
+        sha256_process_c( ctx, data );
+        data += 64;
+    }
+}
+
+#if defined(SHA256_X86)
+
+static const uint32_t K[64] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/*
+ * SHA extensions: the state is kept as ABEF / CDGH, sha256rnds2 does two
+ * rounds and sha256msg1 / sha256msg2 compute the message schedule.
+ */
+static __attribute__((target("sha,sse4.1")))
+void sha256_blocks_shani( sha256_context *ctx, const unsigned char *data,
+                          size_t blocks )
+{
+    const __m128i bswap = _mm_set_epi8( 12, 13, 14, 15,  8,  9, 10, 11,
+                                         4,  5,  6,  7,  0,  1,  2,  3 );
+    __m128i state0, state1, abef, cdgh, tmp, M[4];
+    int g;
+
+    tmp    = _mm_loadu_si128( (const __m128i *) &ctx->state[0] );
+    state1 = _mm_loadu_si128( (const __m128i *) &ctx->state[4] );
+    tmp    = _mm_shuffle_epi32( tmp, 0xB1 );             /* CDAB */
+    state1 = _mm_shuffle_epi32( state1, 0x1B );          /* EFGH */
+    state0 = _mm_alignr_epi8( tmp, state1, 8 );          /* ABEF */
+    state1 = _mm_blend_epi16( state1, tmp, 0xF0 );       /* CDGH */
+
+    while( blocks-- > 0 )
+    {
+        abef = state0;
+        cdgh = state1;
+
+        for( g = 0; g < 16; g++ )
+        {
+            if( g < 4 )
+                M[g] = _mm_shuffle_epi8(
+                           _mm_loadu_si128( (const __m128i *) ( data + 16 * g ) ),
+                           bswap );
+            else
+            {
+                tmp = _mm_sha256msg1_epu32( M[g & 3], M[( g + 1 ) & 3] );
+                tmp = _mm_add_epi32( tmp, _mm_alignr_epi8( M[( g + 3 ) & 3],
+                                                           M[( g + 2 ) & 3], 4 ) );
+                M[g & 3] = _mm_sha256msg2_epu32( tmp, M[( g + 3 ) & 3] );
+            }
+
+            tmp = _mm_add_epi32( M[g & 3],
+                                 _mm_loadu_si128( (const __m128i *) &K[4 * g] ) );
+            state1 = _mm_sha256rnds2_epu32( state1, state0, tmp );
+            tmp = _mm_shuffle_epi32( tmp, 0x0E );
+            state0 = _mm_sha256rnds2_epu32( state0, state1, tmp );
+        }
+
+        state0 = _mm_add_epi32( state0, abef );
+        state1 = _mm_add_epi32( state1, cdgh );
+        data += 64;
+    }
+
+    tmp    = _mm_shuffle_epi32( state0, 0x1B );          /* FEBA */
+    state1 = _mm_shuffle_epi32( state1, 0xB1 );          /* DCHG */
+    state0 = _mm_blend_epi16( tmp, state1, 0xF0 );       /* DCBA */
+    state1 = _mm_alignr_epi8( state1, tmp, 8 );          /* HGFE */
+
+    _mm_storeu_si128( (__m128i *) &ctx->state[0], state0 );
+    _mm_storeu_si128( (__m128i *) &ctx->state[4], state1 );
+}
+
+#endif /* SHA256_X86 */
+
+/*
+ * Runtime backend selection
+ */
+typedef void (*sha256_blocks_fn)( sha256_context *, const unsigned char *,
+                                  size_t );
+
+static const struct
+{
+    const char *name;
+    sha256_blocks_fn blocks;
+}
+sha256_backends[SHA256_BACKEND_COUNT] =
+{
+    { "auto",  NULL },
+    { "c",     sha256_blocks_c },
+#if defined(SHA256_X86)
+    { "sha",   sha256_blocks_shani },
+#else
+    { "sha",   NULL },
+#endif
+};
+
+static sha256_blocks_fn sha256_blocks = NULL;
+
+int sha256_backend_supported( int backend )
+{
+#if defined(SHA256_X86)
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int ecx1 = 0, ebx7 = 0;
+
+    if( __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+        ecx1 = ecx;
+    if( __get_cpuid_max( 0, NULL ) >= 7 )
+    {
+        __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+        ebx7 = ebx;
+    }
+#endif
+
+    switch( backend )
+    {
+    case SHA256_BACKEND_AUTO:
+    case SHA256_BACKEND_C:
+        return( 1 );
+#if defined(SHA256_X86)
+    case SHA256_BACKEND_SHANI:
+        return( ( ebx7 & bit_SHA ) != 0 && ( ecx1 & bit_SSE4_1 ) != 0 );
+#endif
+    default:
+        return( 0 );
+    }
+}
+
+const char *sha256_backend_name( int backend )
+{
+    if( backend == SHA256_BACKEND_AUTO && sha256_blocks != NULL )
+    {
+        int i;
+        for( i = SHA256_BACKEND_C; i < SHA256_BACKEND_COUNT; i++ )
+            if( sha256_backends[i].blocks == sha256_blocks )
+                return( sha256_backends[i].name );
+    }
+
+    if( backend < 0 || backend >= SHA256_BACKEND_COUNT )
+        return( NULL );
+
+    return( sha256_backends[backend].name );
+}
+
+int sha256_set_backend( int backend )
+{
+    if( !sha256_backend_supported( backend ) )
+        return( -1 );
+
+    if( backend == SHA256_BACKEND_AUTO )
+    {
+        /* Fastest first */
+        for( backend = SHA256_BACKEND_COUNT - 1;
+             backend > SHA256_BACKEND_C; backend-- )
+            if( sha256_backends[backend].blocks != NULL
+                && sha256_backend_supported( backend ) )
+                break;
+    }
+
+    sha256_blocks = sha256_backends[backend].blocks;
+    return( 0 );
+}
+
+static void sha256_process_blocks( sha256_context *ctx,
+                                   const unsigned char *data, size_t blocks )
+{
+    if( sha256_blocks == NULL )
+        sha256_set_backend( SHA256_BACKEND_AUTO );
+
+    sha256_blocks( ctx, data, blocks );
+}
+
+void sha256_process( sha256_context *ctx, const unsigned char data[64] )
+{
+    sha256_process_blocks( ctx, data, 1 );
+}
+
 /*
  * SHA-256 process buffer
  */
@@ -253,11 +480,11 @@ void sha256_update( sha256_context *ctx, const unsigned char *input, size_t ilen
         left = 0;
     }
 
-    while( ilen >= 64 )
+    if( ilen >= 64 )
     {
-        sha256_process( ctx, input );
-        input += 64;
-        ilen  -= 64;
+        sha256_process_blocks( ctx, input, ilen / 64 );
+        input += ilen & ~(size_t) 63;
+        ilen  &= 63;
     }
 
     if( ilen > 0 )
@@ -332,6 +559,34 @@ int sha256_file( const char *path, unsigned char output[32], int is224 )
     sha256_context ctx;
     unsigned char buf[1024];
 
+#if defined(SHA256_USE_MMAP)
+    /* Large files are mapped and hashed in one go, small ones and anything
+       that cannot be mapped are read below */
+    {
+        int fd;
+        struct stat st;
+
+        if( ( fd = open( path, O_RDONLY ) ) < 0 )
+            return( ERR_SHA256_FILE_IO_ERROR );
+
+        if( fstat( fd, &st ) == 0 && S_ISREG( st.st_mode )
+            && st.st_size >= SHA256_MMAP_THRESHOLD )
+        {
+            void *p = mmap( NULL, (size_t) st.st_size, PROT_READ,
+                            MAP_PRIVATE, fd, 0 );
+            if( p != MAP_FAILED )
+            {
+                sha256( (const unsigned char *) p, (size_t) st.st_size,
+                        output, is224 );
+                munmap( p, (size_t) st.st_size );
+                close( fd );
+                return( 0 );
+            }
+        }
+        close( fd );
+    }
+#endif
+
     if( ( f = fopen( path, "rb" ) ) == NULL )
         return( ERR_SHA256_FILE_IO_ERROR );
 
@@ -602,9 +857,9 @@ static const unsigned char sha256_hmac_test_sum[14][32] =
 };
 
 /*
- * Checkup routine
+ * Checkup routine, for the currently selected backend
  */
-int sha256_self_test( int verbose )
+static int sha256_self_test_1( int verbose )
 {
     int i, j, k, buflen;
     unsigned char buf[1024];
@@ -692,4 +947,82 @@ int sha256_self_test( int verbose )
 }
 
 
+/*
+ * Run the test vectors against every backend this CPU supports
+ */
+int sha256_self_test( int verbose )
+{
+    int backend, ret = 0;
+
+    for( backend = SHA256_BACKEND_C; backend < SHA256_BACKEND_COUNT; backend++ )
+    {
+        if( sha256_backends[backend].blocks == NULL
+            || sha256_set_backend( backend ) != 0 )
+            continue;
+
+        if( verbose != 0 )
+            printf( "  SHA-256 backend %s:\n", sha256_backend_name( backend ) );
+
+        if( sha256_self_test_1( verbose ) != 0 )
+        {
+            ret = 1;
+            break;
+        }
+    }
+
+    sha256_set_backend( SHA256_BACKEND_AUTO );
+    return( ret );
+}
+
+/*
+ * Throughput of each backend on a 16 MiB buffer
+ */
+int sha256_benchmark( int verbose )
+{
+    const size_t len = 16 * 1024 * 1024;
+    unsigned char ref[32], sum[32];
+    unsigned char *buf;
+    int backend, ret = 0, have_ref = 0;
+    size_t i;
+
+    if( ( buf = (unsigned char *) malloc( len ) ) == NULL )
+        return( 1 );
+
+    for( i = 0; i < len; i++ )
+        buf[i] = (unsigned char) ( i * 251 + ( i >> 8 ) );
+
+    for( backend = SHA256_BACKEND_C; backend < SHA256_BACKEND_COUNT; backend++ )
+    {
+        clock_t start;
+        double secs;
+
+        if( sha256_backends[backend].blocks == NULL
+            || sha256_set_backend( backend ) != 0 )
+            continue;
+
+        start = clock();
+        sha256( buf, len, sum, 0 );
+        secs = (double) ( clock() - start ) / CLOCKS_PER_SEC;
+
+        if( !have_ref )
+        {
+            memcpy( ref, sum, 32 );
+            have_ref = 1;
+        }
+        else if( memcmp( ref, sum, 32 ) != 0 )
+            ret = 1;
+
+        if( verbose != 0 )
+            printf( "  SHA-256 %-6s: %8.1f MB/s%s\n",
+                    sha256_backend_name( backend ),
+                    secs > 0 ? len / ( secs * 1024 * 1024 ) : 0.0,
+                    ret ? " (mismatch)" : "" );
+    }
+
+    sha256_set_backend( SHA256_BACKEND_AUTO );
+    free( buf );
+    return( ret );
+}
+
+
 #endif
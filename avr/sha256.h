@@ -91,6 +91,39 @@ void sha256_finish( sha256_context *ctx, unsigned char output[32] );
 /* Internal use */
 void sha256_process( sha256_context *ctx, const unsigned char data[64] );
 
+/*
+ * Block function backends, selected from the CPU features at the first use
+ */
+#define SHA256_BACKEND_AUTO     0   /*!< fastest supported backend      */
+#define SHA256_BACKEND_C        1   /*!< portable C                     */
+#define SHA256_BACKEND_SHANI    2   /*!< x86 SHA extensions             */
+#define SHA256_BACKEND_COUNT    3
+
+/**
+ * \brief          Select the block function backend
+ *
+ * \param backend  one of the SHA256_BACKEND_* values
+ *
+ * \return         0 if successful, or -1 if the backend is not supported
+ *                 by this CPU or build
+ */
+int sha256_set_backend( int backend );
+
+/**
+ * \brief          Check whether a backend can be used
+ *
+ * \param backend  one of the SHA256_BACKEND_* values
+ *
+ * \return         1 if supported by this CPU, 0 otherwise
+ */
+int sha256_backend_supported( int backend );
+
+/**
+ * \brief          Name of a backend; for SHA256_BACKEND_AUTO the backend
+ *                 currently selected, once one is
+ */
+const char *sha256_backend_name( int backend );
+
 #ifdef __cplusplus
 }
 #endif
@@ -181,6 +214,13 @@ void sha256_hmac( const unsigned char *key, size_t keylen,
  */
 int sha256_self_test( int verbose );
 
+/**
+ * \brief          Print the throughput of each supported backend in MB/s
+ *
+ * \return         0 if successful, or 1 if the backends disagree
+ */
+int sha256_benchmark( int verbose );
+
 #ifdef __cplusplus
 }
 #endif
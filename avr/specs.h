@@ -78,3 +78,31 @@ along with GCC; see the file COPYING3.  If not see
 
 #define STARTFILE_SPEC ""
 #define ENDFILE_SPEC ""
+
+/* Defaults for the subspecs of the device specs files.  For a device
+   from the device database no specs file is read, and the device's
+   properties are options added by DRIVER_SELF_SPECS, see driver-avr.c.
+   A device specs file supersedes these.  */
+
+#ifdef HAVE_AS_AVR_MLINK_RELAX_OPTION
+#define AVR_ASM_RELAX_EXTRA_SPEC { "asm_relax", ASM_RELAX_SPEC },
+#else
+#define AVR_ASM_RELAX_EXTRA_SPEC
+#endif
+
+#ifdef HAVE_AS_AVR_MRMW_OPTION
+#define AVR_ASM_RMW_EXTRA_SPEC { "asm_rmw", "%{mrmw}" },
+#else
+#define AVR_ASM_RMW_EXTRA_SPEC
+#endif
+
+#define AVR_EXTRA_SPECS                                 \
+  { "asm_arch", "%{mmcu=*:-mmcu=%*}" },                 \
+  AVR_ASM_RELAX_EXTRA_SPEC                              \
+  AVR_ASM_RMW_EXTRA_SPEC                                \
+  { "asm_errata_skip", "%{mno-skip-bug}" },             \
+  { "link_arch", LINK_ARCH_SPEC },                      \
+  { "link_relax", LINK_RELAX_SPEC },
+
+#undef  EXTRA_SPECS
+#define EXTRA_SPECS AVR_EXTRA_SPECS
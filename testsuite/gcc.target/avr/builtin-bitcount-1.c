@@ -0,0 +1,122 @@
+/* { dg-do run } */
+/* { dg-options "-O2" } */
+
+/* The inline popcount, parity, clz, ctz and ffs for 8, 16 and 32-bit
+   values and the inline bswap32 against bit-by-bit references.  */
+
+typedef __UINT8_TYPE__ u8;
+typedef __UINT16_TYPE__ u16;
+typedef __UINT32_TYPE__ u32;
+
+#define NI __attribute__((noinline, noclone))
+
+#define INT_BITS (8 * __SIZEOF_INT__)
+#define LONG_BITS (8 * __SIZEOF_LONG__)
+
+/* 8-bit values are promoted to int; combine narrows popcount and
+   parity back to QImode.  */
+
+NI int popcount_qi (u8 x) { return __builtin_popcount (x); }
+NI int parity_qi (u8 x)   { return __builtin_parity (x); }
+NI int clz_qi (u8 x)      { return __builtin_clz (x); }
+NI int ctz_qi (u8 x)      { return __builtin_ctz (x); }
+NI int ffs_qi (u8 x)      { return __builtin_ffs (x); }
+
+NI int popcount_hi (unsigned x) { return __builtin_popcount (x); }
+NI int parity_hi (unsigned x)   { return __builtin_parity (x); }
+NI int clz_hi (unsigned x)      { return __builtin_clz (x); }
+NI int ctz_hi (unsigned x)      { return __builtin_ctz (x); }
+NI int ffs_hi (int x)           { return __builtin_ffs (x); }
+
+NI int popcount_si (unsigned long x) { return __builtin_popcountl (x); }
+NI int parity_si (unsigned long x)   { return __builtin_parityl (x); }
+NI int clz_si (unsigned long x)      { return __builtin_clzl (x); }
+NI int ctz_si (unsigned long x)      { return __builtin_ctzl (x); }
+NI int ffs_si (long x)               { return __builtin_ffsl (x); }
+
+NI u32 bswap_si (u32 x) { return __builtin_bswap32 (x); }
+
+int ref_popcount (u32 x)
+{
+  int n = 0;
+  for (; x; x >>= 1)
+    n += x & 1;
+  return n;
+}
+
+int ref_clz (u32 x, int bits)
+{
+  int n = 0;
+  while (!(x & (1UL << (bits - 1 - n))))
+    n++;
+  return n;
+}
+
+int ref_ctz (u32 x)
+{
+  int n = 0;
+  while (!(x & (1UL << n)))
+    n++;
+  return n;
+}
+
+int ref_ffs (u32 x)
+{
+  return x ? 1 + ref_ctz (x) : 0;
+}
+
+u32 ref_bswap (u32 x)
+{
+  return ((x >> 24) | ((x >> 8) & 0xff00)
+          | ((x << 8) & 0xff0000) | (x << 24));
+}
+
+#define CHECK(M, X, BITS)                                               \
+  do {                                                                  \
+    if (popcount_##M (X) != ref_popcount (X)                            \
+        || parity_##M (X) != (ref_popcount (X) & 1)                     \
+        || ffs_##M (X) != ref_ffs (X))                                  \
+      __builtin_abort ();                                               \
+    if ((X) != 0                                                        \
+        && (clz_##M (X) != ref_clz (X, BITS)                            \
+            || ctz_##M (X) != ref_ctz (X)))                             \
+      __builtin_abort ();                                               \
+  } while (0)
+
+void test (u32 x)
+{
+  u8 q = x;
+  u16 h = x;
+
+  CHECK (qi, q, INT_BITS);
+  CHECK (hi, h, INT_BITS);
+  CHECK (si, x, LONG_BITS);
+
+  if (bswap_si (x) != ref_bswap (x))
+    __builtin_abort ();
+}
+
+int main (void)
+{
+  u32 x = 1;
+
+  test (0);
+  test (0xffffffff);
+
+  /* Single-bit values in every byte, and all pairs of bits.  */
+
+  for (int i = 0; i < 32; i++)
+    for (int j = 0; j < 32; j++)
+      test ((1UL << i) | (1UL << j));
+
+  for (int i = 0; i < 32; i++)
+    {
+      test (-1UL << i);
+      test (-1UL >> i);
+    }
+
+  for (int i = 0; i < 200; i++)
+    test (x = x * 1103515245 + 12345);
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+/* { dg-do run } */
+/* { dg-options "-O2" } */
+
+/* The saturated integer built-ins with constant arguments, folded by
+   avr_fold_sat, against the same built-ins at run time and against a
+   reference computed in wider arithmetic.  */
+
+typedef __INT8_TYPE__ s8;
+typedef __INT16_TYPE__ s16;
+typedef __INT32_TYPE__ s32;
+typedef __UINT8_TYPE__ u8;
+typedef __UINT16_TYPE__ u16;
+typedef __UINT32_TYPE__ u32;
+
+typedef long long s64;
+
+#define NI __attribute__((noinline, noclone))
+
+/* Values at and next to the limits, and around 0.  */
+
+#define VALS_s8(X, ...)                                                 \
+  X (__VA_ARGS__, -128) X (__VA_ARGS__, -127) X (__VA_ARGS__, -1)       \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1)                                 \
+  X (__VA_ARGS__, 126) X (__VA_ARGS__, 127)
+
+#define VALS_s16(X, ...)                                                \
+  X (__VA_ARGS__, -32768L) X (__VA_ARGS__, -32767) X (__VA_ARGS__, -1)  \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1)                                 \
+  X (__VA_ARGS__, 32766) X (__VA_ARGS__, 32767)
+
+#define VALS_s32(X, ...)                                                \
+  X (__VA_ARGS__, (-2147483647L - 1)) X (__VA_ARGS__, -2147483647L)     \
+  X (__VA_ARGS__, -1) X (__VA_ARGS__, 0) X (__VA_ARGS__, 1)             \
+  X (__VA_ARGS__, 2147483646L) X (__VA_ARGS__, 2147483647L)
+
+#define VALS_u8(X, ...)                                                 \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1) X (__VA_ARGS__, 127)            \
+  X (__VA_ARGS__, 128) X (__VA_ARGS__, 254) X (__VA_ARGS__, 255)
+
+#define VALS_u16(X, ...)                                                \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1) X (__VA_ARGS__, 32767)          \
+  X (__VA_ARGS__, 32768U) X (__VA_ARGS__, 65534U) X (__VA_ARGS__, 65535U)
+
+#define VALS_u32(X, ...)                                                \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1) X (__VA_ARGS__, 2147483647UL)   \
+  X (__VA_ARGS__, 2147483648UL) X (__VA_ARGS__, 4294967294UL)           \
+  X (__VA_ARGS__, 4294967295UL)
+
+/* A copy of the above for the second operand.  */
+
+#define VALS2_s8(X, ...)                                                \
+  X (__VA_ARGS__, -128) X (__VA_ARGS__, -127) X (__VA_ARGS__, -1)       \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1)                                 \
+  X (__VA_ARGS__, 126) X (__VA_ARGS__, 127)
+
+#define VALS2_s16(X, ...)                                               \
+  X (__VA_ARGS__, -32768L) X (__VA_ARGS__, -32767) X (__VA_ARGS__, -1)  \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1)                                 \
+  X (__VA_ARGS__, 32766) X (__VA_ARGS__, 32767)
+
+#define VALS2_s32(X, ...)                                               \
+  X (__VA_ARGS__, (-2147483647L - 1)) X (__VA_ARGS__, -2147483647L)     \
+  X (__VA_ARGS__, -1) X (__VA_ARGS__, 0) X (__VA_ARGS__, 1)             \
+  X (__VA_ARGS__, 2147483646L) X (__VA_ARGS__, 2147483647L)
+
+#define VALS2_u8(X, ...)                                                \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1) X (__VA_ARGS__, 127)            \
+  X (__VA_ARGS__, 128) X (__VA_ARGS__, 254) X (__VA_ARGS__, 255)
+
+#define VALS2_u16(X, ...)                                               \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1) X (__VA_ARGS__, 32767)          \
+  X (__VA_ARGS__, 32768U) X (__VA_ARGS__, 65534U) X (__VA_ARGS__, 65535U)
+
+#define VALS2_u32(X, ...)                                               \
+  X (__VA_ARGS__, 0) X (__VA_ARGS__, 1) X (__VA_ARGS__, 2147483647UL)   \
+  X (__VA_ARGS__, 2147483648UL) X (__VA_ARGS__, 4294967294UL)           \
+  X (__VA_ARGS__, 4294967295UL)
+
+#define MIN_s8  (-128)
+#define MAX_s8  127
+#define MIN_s16 (-32768L)
+#define MAX_s16 32767
+#define MIN_s32 (-2147483647L - 1)
+#define MAX_s32 2147483647L
+#define MIN_u8  0
+#define MAX_u8  255
+#define MIN_u16 0
+#define MAX_u16 65535U
+#define MIN_u32 0
+#define MAX_u32 4294967295UL
+
+/* Built-in, value type, exact result in terms of a and b.  */
+
+#define BINOPS(X)                                                       \
+  X (ssadd8,  s8,  a + b)  X (sssub8,  s8,  a - b)                      \
+  X (ssadd16, s16, a + b)  X (sssub16, s16, a - b)                      \
+  X (ssadd32, s32, a + b)  X (sssub32, s32, a - b)                      \
+  X (usadd8,  u8,  a + b)  X (ussub8,  u8,  a - b)                      \
+  X (usadd16, u16, a + b)  X (ussub16, u16, a - b)                      \
+  X (usadd32, u32, a + b)  X (ussub32, u32, a - b)
+
+#define UNOPS(X)                                                        \
+  X (ssneg8,  s8,  -a)  X (ssabs8,  s8,  a < 0 ? -a : a)                \
+  X (ssneg16, s16, -a)  X (ssabs16, s16, a < 0 ? -a : a)                \
+  X (ssneg32, s32, -a)  X (ssabs32, s32, a < 0 ? -a : a)
+
+#define DEF_CHECK(T)                                                    \
+  NI void check_##T (T folded, T run, T expect)                         \
+  {                                                                     \
+    if (folded != expect || run != expect)                              \
+      __builtin_abort ();                                               \
+  }
+
+DEF_CHECK (s8)  DEF_CHECK (s16)  DEF_CHECK (s32)
+DEF_CHECK (u8)  DEF_CHECK (u16)  DEF_CHECK (u32)
+
+#define SAT(T, R)                                                       \
+  ((T) ((R) < MIN_##T ? MIN_##T : (R) > MAX_##T ? MAX_##T : (R)))
+
+#define DEF_RUN2(N, T, R)                                               \
+  NI T run_##N (T a, T b) { return __builtin_avr_##N (a, b); }
+
+#define DEF_RUN1(N, T, R)                                               \
+  NI T run_##N (T a) { return __builtin_avr_##N (a); }
+
+BINOPS (DEF_RUN2)
+UNOPS (DEF_RUN1)
+
+/* The operands must be literals so that the built-ins are folded.  */
+
+#define CHECK2_B(N, T, R, A, B)                                         \
+  check_##T (__builtin_avr_##N (A, B), run_##N (A, B),                  \
+             ({ s64 a = (A), b = (B); SAT (T, R); }));
+
+#define CHECK2_A(N, T, R, A) VALS2_##T (CHECK2_B, N, T, R, A)
+
+#define CHECK1(N, T, R, A)                                              \
+  check_##T (__builtin_avr_##N (A), run_##N (A),                        \
+             ({ s64 a = (A); SAT (T, R); }));
+
+#define DEF_TEST2(N, T, R)                                              \
+  void test_##N (void) { VALS_##T (CHECK2_A, N, T, R) }
+
+#define DEF_TEST1(N, T, R)                                              \
+  void test_##N (void) { VALS_##T (CHECK1, N, T, R) }
+
+BINOPS (DEF_TEST2)
+UNOPS (DEF_TEST1)
+
+#define CALL_TEST(N, T, R) test_##N ();
+
+int main (void)
+{
+  BINOPS (CALL_TEST)
+  UNOPS (CALL_TEST)
+
+  return 0;
+}
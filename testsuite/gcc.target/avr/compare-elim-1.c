@@ -0,0 +1,66 @@
+/* { dg-do run } */
+/* { dg-options "-Os" } */
+
+/* The TST after the SUB is ignored by final and the branches use the N
+   flag of the SUB.  The flags must not be assumed to serve a signed
+   comparison after the first branch.  */
+
+typedef __INT8_TYPE__ int8_t;
+
+volatile int8_t n_f, n_g;
+
+__attribute__((noinline, noclone))
+void f (void)
+{
+  n_f++;
+}
+
+__attribute__((noinline, noclone))
+void g (void)
+{
+  n_g++;
+}
+
+__attribute__((noinline, noclone))
+void test (int8_t a, int8_t b)
+{
+  int8_t x = a - b;
+  if (x >= 0)
+    f ();
+  if (x < 0)
+    g ();
+}
+
+__attribute__((noinline, noclone))
+int8_t sign (int8_t a, int8_t b)
+{
+  int8_t x = a - b;
+  int8_t r = 0;
+  if (x >= 0)
+    r = 1;
+  if (x < 0)
+    r = -1;
+  return r;
+}
+
+int main (void)
+{
+  static const int8_t a[] = { -128, 127, -100, 100, 0, 1, -1 };
+  static const int8_t b[] = { 1, -1, 100, -100, 0, -1, 1 };
+
+  for (unsigned i = 0; i < sizeof (a); i++)
+    {
+      int8_t x = (int8_t) (a[i] - b[i]);
+
+      n_f = n_g = 0;
+      test (a[i], b[i]);
+
+      if (n_f != (x >= 0) || n_g != (x < 0))
+        __builtin_abort ();
+
+      if (sign (a[i], b[i]) != (x < 0 ? -1 : 1))
+        __builtin_abort ();
+    }
+
+  return 0;
+}
@@ -0,0 +1,25 @@
+/* { dg-do compile } */
+/* { dg-options "-Os -fdump-rtl-avr-compare-elim" } */
+
+/* The flags of the first compare are still known after the branch,
+   hence the second compare of X against 10 is redundant.  */
+
+typedef __UINT8_TYPE__ uint8_t;
+
+extern void a (void);
+extern void b (void);
+extern void c (void);
+
+void test (uint8_t x)
+{
+  if (x == 10)
+    a ();
+  else if (x < 10)
+    b ();
+  else
+    c ();
+}
+
+/* { dg-final { scan-rtl-dump "deleting redundant compare insn" "avr-compare-elim" } } */
+/* { dg-final { scan-assembler-times "cpi r24,lo8\\(10\\)" 1 } } */
+/* { dg-final { cleanup-rtl-dump "avr-compare-elim" } } */
@@ -0,0 +1,87 @@
+/* { dg-do run } */
+/* { dg-options "-O2" } */
+
+/* Division and modulo by constants against the division by a variable.
+   On devices with MUL, HImode uses the multiply-high of __[u]mulhisi3,
+   and SImode and PSImode use the inline <extend_su>mulsi3_highpart.  */
+
+typedef __INT16_TYPE__ s16;
+typedef __UINT16_TYPE__ u16;
+typedef __int24 s24;
+typedef __uint24 u24;
+typedef __INT32_TYPE__ s32;
+typedef __UINT32_TYPE__ u32;
+
+#define CONSTS_16(X, T) \
+  X (T, 2, 2) X (T, 4, 4) X (T, 7, 7) X (T, 10, 10) X (T, 128, 128) \
+  X (T, 1000, 1000) X (T, max, 0x7fff)
+
+#define CONSTS_24(X, T) \
+  X (T, 2, 2) X (T, 7, 7) X (T, 10, 10) X (T, 256, 256) \
+  X (T, 100000, 100000) X (T, max, 0x7fffff)
+
+#define CONSTS_32(X, T) \
+  X (T, 2, 2) X (T, 16, 16) X (T, 7, 7) X (T, 10, 10) \
+  X (T, 1000000, 1000000) X (T, max, 0x7fffffff)
+
+#define DEF(T, N, C)                                    \
+  __attribute__((noinline, noclone))                    \
+  T div_##T##_##N (T x) { return x / (T) (C); }         \
+  __attribute__((noinline, noclone))                    \
+  T mod_##T##_##N (T x) { return x % (T) (C); }
+
+#define CHECK(T, N, C)                                  \
+  if (div_##T##_##N (x) != ref_div_##T (x, (T) (C))     \
+      || mod_##T##_##N (x) != ref_mod_##T (x, (T) (C))) \
+    __builtin_abort ();
+
+#define TEST(T, CONSTS)                                 \
+  __attribute__((noinline, noclone))                    \
+  T ref_div_##T (T x, T y) { return x / y; }            \
+  __attribute__((noinline, noclone))                    \
+  T ref_mod_##T (T x, T y) { return x % y; }            \
+  CONSTS (DEF, T)                                       \
+  void test_##T (T x) { CONSTS (CHECK, T) }
+
+TEST (s16, CONSTS_16)
+TEST (u16, CONSTS_16)
+TEST (s24, CONSTS_24)
+TEST (u24, CONSTS_24)
+TEST (s32, CONSTS_32)
+TEST (u32, CONSTS_32)
+
+const u32 values[] =
+  {
+    0, 1, 2, 6, 7, 9, 10, 0x7f, 0x80, 0xff, 0x3e8, 0x7fff, 0x8000, 0xffff,
+    0x7fffff, 0x800000, 0xffffff, 12345678, 0x7fffffff, 0x80000000,
+    0x80000001, 0xfffffffe, 0xffffffff
+  };
+
+void test (u32 x)
+{
+  test_s16 ((s16) x);
+  test_u16 ((u16) x);
+  test_s24 ((s24) x);
+  test_u24 ((u24) x);
+  test_s32 ((s32) x);
+  test_u32 ((u32) x);
+  test_s16 ((s16) -x);
+  test_s24 ((s24) -x);
+  test_s32 ((s32) -x);
+}
+
+int main (void)
+{
+  u32 x = 1;
+
+  for (unsigned i = 0; i < sizeof (values) / sizeof (*values); i++)
+    test (values[i]);
+
+  for (unsigned i = 0; i < 100; i++)
+    {
+      x = x * 1103515245 + 12345;
+      test (x);
+    }
+
+  return 0;
+}
@@ -0,0 +1,20 @@
+/* { dg-do compile } */
+/* { dg-options "-O2 -mmcu=atmega168" } */
+
+/* On a MUL device, the SImode division by a constant uses the inline
+   multiply-high, the HImode one calls __umulhisi3.  */
+
+__UINT32_TYPE__ div32 (__UINT32_TYPE__ x)
+{
+  return x / 10;
+}
+
+__UINT16_TYPE__ div16 (__UINT16_TYPE__ x)
+{
+  return x / 10;
+}
+
+/* { dg-final { scan-assembler-not "__udivmodsi4" } } */
+/* { dg-final { scan-assembler-not "__umulsidi3" } } */
+/* { dg-final { scan-assembler-not "__udivmodhi4" } } */
+/* { dg-final { scan-assembler "__umulhisi3" } } */
@@ -0,0 +1,16 @@
+/* { dg-do compile } */
+/* { dg-options "-Os" } */
+
+/* A loop with at most 255 iterations gets a QImode counter.  */
+
+typedef __UINT8_TYPE__ uint8_t;
+
+extern volatile uint8_t v;
+
+void test (uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++)
+    v = 0;
+}
+
+/* { dg-final { scan-assembler "\tdec r\[0-9\]+\n\tbrne " } } */
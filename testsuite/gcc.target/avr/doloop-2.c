@@ -0,0 +1,58 @@
+/* { dg-do run } */
+/* { dg-options "-Os" } */
+
+typedef __UINT8_TYPE__ uint8_t;
+typedef __UINT16_TYPE__ uint16_t;
+
+volatile uint16_t count;
+
+__attribute__((noinline, noclone))
+void loop8 (uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++)
+    count++;
+}
+
+__attribute__((noinline, noclone))
+void loop16 (uint16_t n)
+{
+  for (uint16_t i = 0; i < n; i++)
+    count++;
+}
+
+__attribute__((noinline, noclone))
+void loop16_mem (uint16_t n, volatile uint16_t *p)
+{
+  for (uint16_t i = 0; i < n; i++)
+    *p += i;
+}
+
+int main (void)
+{
+  static const uint8_t n8[] = { 0, 1, 2, 255 };
+  static const uint16_t n16[] = { 0, 1, 255, 256, 1000 };
+  volatile uint16_t sum;
+
+  for (unsigned i = 0; i < sizeof (n8) / sizeof (*n8); i++)
+    {
+      count = 0;
+      loop8 (n8[i]);
+      if (count != n8[i])
+        __builtin_abort ();
+    }
+
+  for (unsigned i = 0; i < sizeof (n16) / sizeof (*n16); i++)
+    {
+      count = 0;
+      loop16 (n16[i]);
+      if (count != n16[i])
+        __builtin_abort ();
+
+      sum = 0;
+      loop16_mem (n16[i], &sum);
+      if (sum != (uint16_t) (n16[i] * (n16[i] - 1u) / 2))
+        __builtin_abort ();
+    }
+
+  return 0;
+}
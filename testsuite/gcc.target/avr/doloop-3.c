@@ -0,0 +1,19 @@
+/* { dg-do compile } */
+/* { dg-options "-Os -mmcu=attiny2313" } */
+
+/* The loop body is longer than 2K words, but the device has no JMP:
+   RJMP wraps around the flash.  */
+
+#define NOP4 "nop\n\t" "nop\n\t" "nop\n\t" "nop\n\t"
+#define NOP16 NOP4 NOP4 NOP4 NOP4
+#define NOP64 NOP16 NOP16 NOP16 NOP16
+#define NOP256 NOP64 NOP64 NOP64 NOP64
+#define NOP2048 NOP256 NOP256 NOP256 NOP256 NOP256 NOP256 NOP256 NOP256
+
+void loop (unsigned char n)
+{
+  for (unsigned char i = 0; i < n; i++)
+    __asm volatile (NOP2048 NOP64);
+}
+
+/* { dg-final { scan-assembler-not "\\tjmp" } } */
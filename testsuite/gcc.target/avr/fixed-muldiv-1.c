@@ -0,0 +1,125 @@
+/* { dg-do run } */
+/* { dg-options "-O2" } */
+
+/* Fixed-point multiplication and division by constants as expanded at
+   -O2 against the libgcc functions.  The reference multiplications are
+   cold and hence call __mul<mode>3; the reference divisions divide by a
+   variable and hence call __div<mode>3.  The non-saturating division
+   is only compared where the quotient is in range.  */
+
+#include <stdfix.h>
+
+typedef __INT64_TYPE__ s64;
+
+#define NI __attribute__((noinline, noclone))
+
+/* Type, integer type, fbit, bits -> fixed, fixed -> bits.  */
+#define TYPES(X)                                                \
+  X (hq, _Fract, int_r_t, 15, rbits, bitsr)                     \
+  X (ha, short _Accum, int_hk_t, 7, hkbits, bitshk)             \
+  X (sq, long _Fract, int_lr_t, 31, lrbits, bitslr)             \
+  X (sa, _Accum, int_k_t, 15, kbits, bitsk)
+
+/* Divisors:  -1, the smallest magnitudes, and some more.  */
+#define DIVS_hq(X, M)                                           \
+  X (M, m1, -0.5r - 0.5r)                                       \
+  X (M, eps, 0.000030517578125r)                                \
+  X (M, meps, -0.000030517578125r)                              \
+  X (M, half, 0.5r) X (M, mqu, -0.25r) X (M, max, 0.999969482421875r)
+
+#define DIVS_ha(X, M)                                           \
+  X (M, m1, -1.0hk)                                             \
+  X (M, eps, 0.0078125hk)                                       \
+  X (M, meps, -0.0078125hk)                                     \
+  X (M, 3, 3.0hk) X (M, mqu, -0.25hk) X (M, max, 255.9921875hk)
+
+#define DIVS_sq(X, M)                                           \
+  X (M, m1, -0.5lr - 0.5lr)                                     \
+  X (M, eps, 4.656612873077392578125e-10lr)                     \
+  X (M, meps, -4.656612873077392578125e-10lr)                   \
+  X (M, half, 0.5lr) X (M, mqu, -0.25lr)
+
+#define DIVS_sa(X, M)                                           \
+  X (M, m1, -1.0k)                                              \
+  X (M, eps, 0.000030517578125k)                                \
+  X (M, meps, -0.000030517578125k)                              \
+  X (M, 3, 3.0k) X (M, mqu, -0.25k) X (M, max, 65535.999969482421875k)
+
+#define DEF_DIV(M, N, C)                                        \
+  NI M##_t div_##M##_##N (M##_t x) { return x / (C); }
+
+#define CHECK_DIV(M, N, C)                                      \
+  if (in_range_##M (a, (C))                                     \
+      && FROMBITS_##M (div_##M##_##N (x)) != FROMBITS_##M (ref_div_##M (x, (C)))) \
+    __builtin_abort ();
+
+#define DEF(M, T, I, FBIT, TOFIX, FROMBITS)                     \
+  typedef T M##_t;                                              \
+  typedef I M##_int;                                            \
+  NI M##_t mul_##M (M##_t a, M##_t b) { return a * b; }         \
+  NI __attribute__((cold))                                      \
+  M##_t ref_mul_##M (M##_t a, M##_t b) { return a * b; }        \
+  NI M##_t ref_div_##M (M##_t a, M##_t b) { return a / b; }     \
+  DIVS_##M (DEF_DIV, M)                                         \
+  int in_range_##M (M##_int a, M##_t c)                         \
+  {                                                             \
+    s64 q = ((s64) a << FBIT) / FROMBITS (c);                   \
+    return q == (M##_int) q;                                    \
+  }                                                             \
+  void test_##M (M##_int a, M##_int b)                          \
+  {                                                             \
+    M##_t x = TOFIX (a), y = TOFIX (b);                         \
+    if (FROMBITS (mul_##M (x, y)) != FROMBITS (ref_mul_##M (x, y))) \
+      __builtin_abort ();                                       \
+    DIVS_##M (CHECK_DIV, M)                                     \
+  }
+
+#define FROMBITS_hq bitsr
+#define FROMBITS_ha bitshk
+#define FROMBITS_sq bitslr
+#define FROMBITS_sa bitsk
+
+TYPES (DEF)
+
+typedef __UINT32_TYPE__ u32;
+
+/* Bit patterns in the high 16 bits, the low bits are filled in.  */
+
+const u32 values[] =
+  {
+    0x80000000, 0x80010000, 0xffff0000, 0x00000000, 0x00010000,
+    0x7fff0000, 0x7ffe0000, 0x40000000, 0xc0000000, 0x12340000,
+    0xedcc0000, 0x00800000, 0xff800000
+  };
+
+#define N (sizeof (values) / sizeof (*values))
+
+void test (u32 a, u32 b)
+{
+  test_hq ((int_r_t) (a >> 16), (int_r_t) (b >> 16));
+  test_ha ((int_hk_t) (a >> 16), (int_hk_t) (b >> 16));
+  test_sq ((int_lr_t) a, (int_lr_t) b);
+  test_sa ((int_k_t) a, (int_k_t) b);
+}
+
+int main (void)
+{
+  u32 x = 1;
+
+  for (unsigned i = 0; i < N; i++)
+    for (unsigned j = 0; j < N; j++)
+      {
+        test (values[i], values[j]);
+        test (values[i] | 1, values[j] | 0xffff);
+        test (values[i] | 0x7fff, values[j] | 0x8000);
+      }
+
+  for (unsigned i = 0; i < 100; i++)
+    {
+      u32 a = x = x * 1103515245 + 12345;
+      u32 b = x = x * 1103515245 + 12345;
+      test (a, b);
+    }
+
+  return 0;
+}
@@ -0,0 +1,25 @@
+/* { dg-do compile } */
+/* { dg-options "-Os -fipa-ra" } */
+
+/* The callee is output before the ISR and only changes R24, hence the
+   ISR saves R24 but none of the other call-used registers.  */
+
+volatile unsigned char counter;
+
+static __attribute__((noinline, noclone))
+void count (void)
+{
+  counter++;
+}
+
+__attribute__((signal))
+void __vector_1 (void)
+{
+  count ();
+}
+
+/* { dg-final { scan-assembler "push r24" } } */
+/* { dg-final { scan-assembler-not "push r18" } } */
+/* { dg-final { scan-assembler-not "push r25" } } */
+/* { dg-final { scan-assembler-not "push r26" } } */
+/* { dg-final { scan-assembler-not "push r30" } } */
@@ -0,0 +1,18 @@
+/* { dg-do compile } */
+/* { dg-options "-Os -fipa-ra" } */
+
+/* The callee is external, hence the ISR must save all call-used
+   registers.  */
+
+extern void count (void);
+
+__attribute__((signal))
+void __vector_1 (void)
+{
+  count ();
+}
+
+/* { dg-final { scan-assembler "push r18" } } */
+/* { dg-final { scan-assembler "push r24" } } */
+/* { dg-final { scan-assembler "push r26" } } */
+/* { dg-final { scan-assembler "push r30" } } */
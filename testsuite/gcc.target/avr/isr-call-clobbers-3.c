@@ -0,0 +1,41 @@
+/* { dg-do run } */
+/* { dg-options "-Os -fipa-ra -mcall-prologues" } */
+
+/* With -mcall-prologues, __epilogue_restores__ changes X.  The ISR must
+   save X although the callee itself doesn't use it.  The ISR is called
+   directly to check that the caller's X survives.  */
+
+volatile unsigned char sink;
+
+static __attribute__((noinline, noclone))
+void callee (void)
+{
+  volatile char buf[20];
+  register unsigned char a asm ("r2") = sink;
+  register unsigned char b asm ("r3") = sink;
+  __asm volatile ("" : "+r" (a), "+r" (b));
+  for (unsigned char i = 0; i < sizeof (buf); i++)
+    buf[i] = a + b + i;
+  sink = buf[sink];
+}
+
+__attribute__((signal))
+void __vector_1 (void)
+{
+  callee ();
+}
+
+int main (void)
+{
+  unsigned int x = 0x1234;
+
+  __asm volatile ("movw r26,%1" "\n\t"
+                  "%~call __vector_1" "\n\t"
+                  "movw %0,r26"
+                  : "=r" (x) : "r" (x) : "r26", "r27", "memory");
+
+  if (x != 0x1234)
+    __builtin_abort ();
+
+  return 0;
+}
@@ -0,0 +1,17 @@
+/* { dg-do compile } */
+/* { dg-options "-Os" } */
+
+/* SBI touches neither SREG nor __tmp_reg__ nor __zero_reg__, hence the
+   ISR needs no saves at all.  */
+
+#define SFR(io) (*(volatile unsigned char*) ((io) + __AVR_SFR_OFFSET__))
+
+__attribute__((signal))
+void __vector_1 (void)
+{
+  SFR (0x10) |= 1 << 2;
+}
+
+/* { dg-final { scan-assembler-not "push __zero_reg__" } } */
+/* { dg-final { scan-assembler-not "push __tmp_reg__" } } */
+/* { dg-final { scan-assembler-not "in __tmp_reg__,__SREG__" } } */
@@ -0,0 +1,20 @@
+/* { dg-do compile } */
+/* { dg-options "-Os" } */
+
+/* The increment changes SREG, which is saved by means of __tmp_reg__.
+   __zero_reg__ is not used.  */
+
+typedef __UINT8_TYPE__ uint8_t;
+
+extern volatile uint8_t count;
+
+__attribute__((signal))
+void __vector_2 (void)
+{
+  count++;
+}
+
+/* { dg-final { scan-assembler-not "push __zero_reg__" } } */
+/* { dg-final { scan-assembler-not "clr __zero_reg__" } } */
+/* { dg-final { scan-assembler-times "push __tmp_reg__" 1 } } */
+/* { dg-final { scan-assembler-times "in __tmp_reg__,__SREG__" 1 } } */
@@ -0,0 +1,54 @@
+/* { dg-do run } */
+/* { dg-options "-Os" } */
+
+/* Call ISRs with pruned saves directly and check that they still work
+   and leave the registers of the caller alone.  */
+
+typedef __UINT8_TYPE__ uint8_t;
+
+volatile uint8_t count, flag;
+
+__attribute__((signal))
+void __vector_1 (void)
+{
+  count++;
+}
+
+__attribute__((signal))
+void __vector_2 (void)
+{
+  flag = 0;
+}
+
+__attribute__((signal))
+void __vector_3 (void)
+{
+}
+
+__attribute__((noinline, noclone))
+uint8_t test (uint8_t x, uint8_t y)
+{
+  uint8_t r = x - y;
+
+  __vector_1 ();
+  __vector_2 ();
+  __vector_3 ();
+
+  return r + x;
+}
+
+int main (void)
+{
+  flag = 1;
+
+  if (test (10, 3) != 17
+      || count != 1
+      || flag != 0)
+    __builtin_abort ();
+
+  __vector_1 ();
+  if (count != 2)
+    __builtin_abort ();
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+/* { dg-do run } */
+/* { dg-options "-O2 -mmcu=avr25" } */
+
+/* Multiplication by constants on a device without MUL against products
+   computed bit by bit.  Negative constants, and constants like 0xe0 =
+   0x100 - 0x20, have a CSD representation whose top digit is -1.  The
+   last constant of each mode exceeds the cost limit and calls libgcc.
+   The factor 1u avoids the signed overflow of int in u8 * u8.  */
+
+typedef __UINT8_TYPE__ u8;
+typedef __UINT16_TYPE__ u16;
+typedef __uint24 u24;
+typedef __UINT32_TYPE__ u32;
+
+#define CONSTS_8(X, T)                                              \
+  X (T, 0, 0) X (T, 1, 1) X (T, 3, 3) X (T, 10, 10) X (T, 0x7f, 0x7f)  \
+  X (T, 0xe0, 0xe0) X (T, m1, -1) X (T, m3, -3) X (T, m16, -16)     \
+  X (T, 0x55, 0x55)
+
+#define CONSTS_16(X, T)                                             \
+  X (T, 10, 10) X (T, 100, 100) X (T, 0x7fff, 0x7fff)               \
+  X (T, 0xff00, 0xff00) X (T, m7, -7) X (T, m100, -100)              \
+  X (T, 0x5555, 0x5555)
+
+#define CONSTS_24(X, T)                                             \
+  X (T, 10, 10) X (T, 1000, 1000) X (T, 0x7fffff, 0x7fffff)         \
+  X (T, m5, -5) X (T, m1000, -1000) X (T, 0x555555, 0x555555)
+
+#define CONSTS_32(X, T)                                             \
+  X (T, 10, 10) X (T, 1000000, 1000000) X (T, 0x7fffffff, 0x7fffffff) \
+  X (T, 0xfff00000, 0xfff00000) X (T, m3, -3) X (T, m60, -60)       \
+  X (T, 0x55555555, 0x55555555)
+
+#define DEF(T, N, C)                                    \
+  __attribute__((noinline, noclone))                    \
+  T mul_##T##_##N (T x) { return 1u * x * (T) (C); }
+
+#define CHECK(T, N, C)                                  \
+  if (mul_##T##_##N (x) != (T) ref_mul (x, (T) (C)))    \
+    __builtin_abort ();
+
+#define TEST(T, CONSTS)                                 \
+  CONSTS (DEF, T)                                       \
+  void test_##T (T x) { CONSTS (CHECK, T) }
+
+/* The low 32 bits of A * B by shift and add.  */
+
+__attribute__((noinline, noclone))
+u32 ref_mul (u32 a, u32 b)
+{
+  u32 p = 0;
+
+  for (; b; b >>= 1, a <<= 1)
+    if (b & 1)
+      p += a;
+
+  return p;
+}
+
+TEST (u8, CONSTS_8)
+TEST (u16, CONSTS_16)
+TEST (u24, CONSTS_24)
+TEST (u32, CONSTS_32)
+
+const u32 values[] =
+  {
+    0, 1, 2, 3, 0x7f, 0x80, 0xff, 0x7fff, 0x8000, 0xffff, 0x7fffff,
+    0x800000, 0xffffff, 12345678, 0x7fffffff, 0x80000000, 0xffffffff
+  };
+
+void test (u32 x)
+{
+  test_u8 ((u8) x);
+  test_u16 ((u16) x);
+  test_u24 ((u24) x);
+  test_u32 (x);
+}
+
+int main (void)
+{
+  u32 x = 1;
+
+  for (unsigned i = 0; i < sizeof (values) / sizeof (*values); i++)
+    test (values[i]);
+
+  for (unsigned i = 0; i < 50; i++)
+    {
+      x = x * 1103515245 + 12345;
+      test (x);
+    }
+
+  return 0;
+}
@@ -0,0 +1,23 @@
+/* { dg-do compile } */
+/* { dg-options "-O2 -mmcu=avr25" } */
+
+/* Without MUL, x * 10 is a short shift-add sequence, while 0x55555555
+   has 16 non-zero CSD digits and exceeds the cost limit.  */
+
+__UINT16_TYPE__ mul10 (__UINT16_TYPE__ x)
+{
+  return x * 10;
+}
+
+__INT16_TYPE__ mul_m16 (__INT16_TYPE__ x)
+{
+  return x * -16;
+}
+
+__UINT32_TYPE__ mul55 (__UINT32_TYPE__ x)
+{
+  return x * 0x55555555;
+}
+
+/* { dg-final { scan-assembler-not "__mulhi3" } } */
+/* { dg-final { scan-assembler "__mulsi3" } } */
@@ -0,0 +1,81 @@
+/* { dg-do run } */
+/* { dg-options "-O2" } */
+
+/* SImode, PSImode and widening HImode to SImode multiplications, which
+   are expanded inline at -O2 on devices with MUL, against products
+   computed bit by bit.  The low part of a product doesn't depend on the
+   signedness, so the non-widening ones are done unsigned to avoid
+   signed overflow.  The mixed-sign ones use usmulhisi3_inline with the
+   operands in either order.  */
+
+typedef __INT16_TYPE__ s16;
+typedef __UINT16_TYPE__ u16;
+typedef __uint24 u24;
+typedef __INT32_TYPE__ s32;
+typedef __UINT32_TYPE__ u32;
+
+#define NI __attribute__((noinline, noclone))
+
+NI u32 mul_u32 (u32 a, u32 b) { return a * b; }
+NI u24 mul_u24 (u24 a, u24 b) { return a * b; }
+NI s32 mul_s16_s16 (s16 a, s16 b) { return (s32) a * b; }
+NI u32 mul_u16_u16 (u16 a, u16 b) { return (u32) a * b; }
+NI s32 mul_u16_s16 (u16 a, s16 b) { return (s32) a * b; }
+NI s32 mul_s16_u16 (s16 a, u16 b) { return (s32) a * b; }
+
+/* The low 32 bits of A * B by shift and add.  */
+
+NI u32 ref_mul (u32 a, u32 b)
+{
+  u32 p = 0;
+
+  for (; b; b >>= 1, a <<= 1)
+    if (b & 1)
+      p += a;
+
+  return p;
+}
+
+const u32 values[] =
+  {
+    0, 1, 2, 3, 0x7f, 0x80, 0xff, 0x100, 0x7fff, 0x8000, 0x8001, 0xffff,
+    0x10000, 0x7fffff, 0x800000, 0xffffff, 0x1000000, 12345678,
+    0x7fffffff, 0x80000000, 0x80000001, 0xfffffffe, 0xffffffff
+  };
+
+#define N (sizeof (values) / sizeof (*values))
+
+void test (u32 a, u32 b)
+{
+  s16 sa16 = (s16) a, sb16 = (s16) b;
+  u16 ua16 = (u16) a, ub16 = (u16) b;
+
+  if (mul_u32 (a, b) != ref_mul (a, b)
+      || mul_u24 ((u24) a, (u24) b) != (u24) ref_mul (a, b))
+    __builtin_abort ();
+
+  if ((u32) mul_s16_s16 (sa16, sb16) != ref_mul ((u32) (s32) sa16,
+                                                 (u32) (s32) sb16)
+      || mul_u16_u16 (ua16, ub16) != ref_mul (ua16, ub16)
+      || (u32) mul_u16_s16 (ua16, sb16) != ref_mul (ua16, (u32) (s32) sb16)
+      || (u32) mul_s16_u16 (sa16, ub16) != ref_mul ((u32) (s32) sa16, ub16))
+    __builtin_abort ();
+}
+
+int main (void)
+{
+  u32 x = 1;
+
+  for (unsigned i = 0; i < N; i++)
+    for (unsigned j = 0; j < N; j++)
+      test (values[i], values[j]);
+
+  for (unsigned i = 0; i < 200; i++)
+    {
+      u32 a = x = x * 1103515245 + 12345;
+      u32 b = x = x * 1103515245 + 12345;
+      test (a, b);
+    }
+
+  return 0;
+}
@@ -0,0 +1,22 @@
+/* { dg-do compile } */
+/* { dg-options "-O2 -mmcu=atmega168" } */
+
+/* On a MUL device these are expanded inline when optimizing for speed.  */
+
+typedef __INT16_TYPE__ s16;
+typedef __UINT16_TYPE__ u16;
+typedef __uint24 u24;
+typedef __INT32_TYPE__ s32;
+typedef __UINT32_TYPE__ u32;
+
+u32 mul_u32 (u32 a, u32 b) { return a * b; }
+u24 mul_u24 (u24 a, u24 b) { return a * b; }
+s32 mul_s16_s16 (s16 a, s16 b) { return (s32) a * b; }
+u32 mul_u16_u16 (u16 a, u16 b) { return (u32) a * b; }
+s32 mul_u16_s16 (u16 a, s16 b) { return (s32) a * b; }
+
+/* { dg-final { scan-assembler-not "__mulsi3" } } */
+/* { dg-final { scan-assembler-not "__mulpsi3" } } */
+/* { dg-final { scan-assembler-not "__mulhisi3" } } */
+/* { dg-final { scan-assembler-not "__umulhisi3" } } */
+/* { dg-final { scan-assembler-not "__usmulhisi3" } } */
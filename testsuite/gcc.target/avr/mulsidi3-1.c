@@ -0,0 +1,82 @@
+/* { dg-do run } */
+/* { dg-options "-O2" } */
+
+/* Signed and unsigned 32 x 32 = 64 bit multiplication against products
+   composed of 16 x 16 = 32 bit partial products.  */
+
+typedef __UINT16_TYPE__ u16;
+typedef __UINT32_TYPE__ u32;
+typedef __INT32_TYPE__ s32;
+typedef __UINT64_TYPE__ u64;
+typedef __INT64_TYPE__ s64;
+
+typedef union
+{
+  u64 x;
+  u32 w[2];
+} dword_t;
+
+#define NI __attribute__((noinline, noclone))
+
+NI u64 umulsidi3 (u32 a, u32 b) { return (u64) a * b; }
+NI s64 mulsidi3 (s32 a, s32 b) { return (s64) a * b; }
+
+NI u32 mul16 (u16 a, u16 b)
+{
+  return (u32) a * b;
+}
+
+NI u64 ref_mul (u32 a, u32 b, int signed_p)
+{
+  u32 ll = mul16 (a, b);
+  u32 lh = mul16 (a, b >> 16);
+  u32 hl = mul16 (a >> 16, b);
+  u32 hh = mul16 (a >> 16, b >> 16);
+  u32 mid = (ll >> 16) + (lh & 0xffff) + (hl & 0xffff);
+  dword_t d;
+
+  d.w[0] = (ll & 0xffff) | (mid << 16);
+  d.w[1] = hh + (lh >> 16) + (hl >> 16) + (mid >> 16);
+
+  /* (a - 2^32) * b = a * b - (b << 32), same for B.  */
+
+  if (signed_p && (s32) a < 0)
+    d.w[1] -= b;
+  if (signed_p && (s32) b < 0)
+    d.w[1] -= a;
+
+  return d.x;
+}
+
+const u32 values[] =
+  {
+    0, 1, 2, 0xff, 0x100, 0xffff, 0x10000, 0x12345678, 0x7ffffffe,
+    0x7fffffff, 0x80000000, 0x80000001, 0xfffffffe, 0xffffffff
+  };
+
+#define N (sizeof (values) / sizeof (*values))
+
+void test (u32 a, u32 b)
+{
+  if (umulsidi3 (a, b) != ref_mul (a, b, 0)
+      || (u64) mulsidi3 ((s32) a, (s32) b) != ref_mul (a, b, 1))
+    __builtin_abort ();
+}
+
+int main (void)
+{
+  u32 x = 1;
+
+  for (unsigned i = 0; i < N; i++)
+    for (unsigned j = 0; j < N; j++)
+      test (values[i], values[j]);
+
+  for (unsigned i = 0; i < 100; i++)
+    {
+      u32 a = x = x * 1103515245 + 12345;
+      u32 b = x = x * 1103515245 + 12345;
+      test (a, b);
+    }
+
+  return 0;
+}
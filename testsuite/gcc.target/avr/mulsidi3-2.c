@@ -0,0 +1,6 @@
+/* { dg-do run } */
+/* { dg-options "-Os" } */
+
+/* With -Os, mulsidi3 calls __[u]mulsidi3 instead.  */
+
+#include "mulsidi3-1.c"
@@ -0,0 +1,20 @@
+/* { dg-do link } */
+/* { dg-options "-Os -flto -mmcu=atmega328p" } */
+/* { dg-additional-sources "pragma-config/pragma-config-1b.c" } */
+
+/* The settings of two TUs in different fuse registers merge:  This TU sets
+   the low fuse, the other one the high fuse.  The high fuse symbol is only
+   defined if the settings of the other TU are kept.  */
+
+#pragma config CKDIV8 = SET
+
+extern const char __config_FUSES_00[];
+extern const char __config_FUSES_01[];
+
+__attribute__((used))
+const void *const config_bytes[] = { __config_FUSES_00, __config_FUSES_01 };
+
+int main (void)
+{
+  return 0;
+}
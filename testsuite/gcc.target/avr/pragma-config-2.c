@@ -0,0 +1,18 @@
+/* { dg-do link } */
+/* { dg-options "-Os -flto -mmcu=atmega328p" } */
+/* { dg-additional-sources "pragma-config/pragma-config-2b.c" } */
+
+/* Both TUs set the low fuse, which must fail the link.  */
+
+#pragma config CKDIV8 = SET
+
+int main (void)
+{
+  return 0;
+}
+
+/* { dg-error "__config_FUSES_00' is already defined" "" { target *-*-* } 0 } */
+/* { dg-prune-output "Assembler messages" } */
+/* { dg-prune-output "lto-wrapper" } */
+/* { dg-prune-output "collect2" } */
+/* { dg-prune-output "compilation terminated" } */
@@ -0,0 +1,5 @@
+#pragma config EESAVE = SET
+
+void func_1b (void)
+{
+}
@@ -0,0 +1,5 @@
+#pragma config CKDIV8 = CLEAR
+
+void func_2b (void)
+{
+}
@@ -0,0 +1,15 @@
+/* { dg-do compile } */
+/* { dg-options "-Os -mshift-ladder=always" } */
+
+/* Shifts by a variable offset use a computed jump into a ladder of
+   one-bit shifts instead of a loop.  */
+
+typedef __UINT16_TYPE__ uint16_t;
+typedef __UINT8_TYPE__ uint8_t;
+
+uint16_t shl (uint16_t x, uint8_t n)
+{
+  return x << n;
+}
+
+/* { dg-final { scan-assembler "\tijmp" } } */
@@ -0,0 +1,12 @@
+/* { dg-do compile } */
+/* { dg-options "-Os -mshift-ladder=loop" } */
+
+typedef __UINT16_TYPE__ uint16_t;
+typedef __UINT8_TYPE__ uint8_t;
+
+uint16_t shl (uint16_t x, uint8_t n)
+{
+  return x << n;
+}
+
+/* { dg-final { scan-assembler-not "\tijmp" } } */
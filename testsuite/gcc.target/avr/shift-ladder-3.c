@@ -0,0 +1,83 @@
+/* { dg-do run } */
+/* { dg-options "-Os -mshift-ladder=always" } */
+
+/* Shifts by variable offsets and by constant offsets that are printed by
+   out_shift_with_cnt, compared against shifts by one bit at a time.  */
+
+typedef __UINT8_TYPE__ uint8_t;
+typedef __INT16_TYPE__ int16_t;
+typedef __UINT16_TYPE__ uint16_t;
+typedef __INT32_TYPE__ int32_t;
+typedef __UINT32_TYPE__ uint32_t;
+
+#define SHIFT(NAME, T, OP)                              \
+  __attribute__((noinline, noclone))                    \
+  T NAME (T x, uint8_t n)                               \
+  {                                                     \
+    return x OP n;                                      \
+  }                                                     \
+                                                        \
+  __attribute__((noinline, noclone))                    \
+  T NAME##_ref (T x, uint8_t n)                         \
+  {                                                     \
+    while (n--)                                         \
+      {                                                 \
+        __asm ("" : "+r" (x));                          \
+        x = x OP 1;                                     \
+      }                                                 \
+    return x;                                           \
+  }
+
+SHIFT (shl16, uint16_t, <<)
+SHIFT (lshr16, uint16_t, >>)
+SHIFT (ashr16, int16_t, >>)
+SHIFT (shl32, uint32_t, <<)
+SHIFT (lshr32, uint32_t, >>)
+SHIFT (ashr32, int32_t, >>)
+
+#define CONST_SHIFT(NAME, T, OP, N)                     \
+  __attribute__((noinline, noclone))                    \
+  T NAME##_##N (T x)                                    \
+  {                                                     \
+    return x OP N;                                      \
+  }
+
+CONST_SHIFT (shl16, uint16_t, <<, 3)
+CONST_SHIFT (ashr16, int16_t, >>, 5)
+CONST_SHIFT (shl32, uint32_t, <<, 3)
+CONST_SHIFT (lshr32, uint32_t, >>, 5)
+CONST_SHIFT (ashr32, int32_t, >>, 7)
+
+int main (void)
+{
+  static const uint32_t vals[] =
+    {
+      0, 1, 0x8000, 0x8001, 0xa5c3, 0x12345678, 0x80000000, 0xfedcba98
+    };
+
+  for (uint8_t i = 0; i < sizeof (vals) / sizeof (*vals); i++)
+    {
+      uint32_t v = vals[i];
+
+      for (uint8_t n = 0; n < 16; n++)
+        if (shl16 (v, n) != shl16_ref (v, n)
+            || lshr16 (v, n) != lshr16_ref (v, n)
+            || ashr16 (v, n) != ashr16_ref (v, n))
+          __builtin_abort ();
+
+      for (uint8_t n = 0; n < 32; n++)
+        if (shl32 (v, n) != shl32_ref (v, n)
+            || lshr32 (v, n) != lshr32_ref (v, n)
+            || ashr32 (v, n) != ashr32_ref (v, n))
+          __builtin_abort ();
+
+      if (shl16_3 (v) != shl16_ref (v, 3)
+          || ashr16_5 (v) != ashr16_ref (v, 5)
+          || shl32_3 (v) != shl32_ref (v, 3)
+          || lshr32_5 (v) != lshr32_ref (v, 5)
+          || ashr32_7 (v) != ashr32_ref (v, 7))
+        __builtin_abort ();
+    }
+
+  return 0;
+}
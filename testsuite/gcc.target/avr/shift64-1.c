@@ -0,0 +1,107 @@
+/* { dg-do run } */
+/* { dg-options "-O2" } */
+
+/* DImode shifts and rotates by each constant 0...63 against a loop that
+   shifts the two 32-bit halves by one bit at a time.  */
+
+typedef __UINT32_TYPE__ u32;
+typedef __INT32_TYPE__ s32;
+typedef __UINT64_TYPE__ u64;
+typedef __INT64_TYPE__ s64;
+
+typedef union
+{
+  u64 x;
+  u32 w[2];
+} dword_t;
+
+#define NI __attribute__((noinline, noclone))
+
+#define SHIFTS(N)                                                     \
+  NI u64 shl_##N (u64 x) { return x << N; }                           \
+  NI u64 shr_##N (u64 x) { return x >> N; }                           \
+  NI s64 sar_##N (s64 x) { return x >> N; }                           \
+  NI u64 rol_##N (u64 x)                                              \
+  {                                                                   \
+    return N == 0 ? x : (x << N) | (x >> ((64 - N) & 63));            \
+  }
+
+#define ENTRY(N) { shl_##N, shr_##N, sar_##N, rol_##N },
+
+#define ALL(M)                                                        \
+  M(0) M(1) M(2) M(3) M(4) M(5) M(6) M(7)                             \
+  M(8) M(9) M(10) M(11) M(12) M(13) M(14) M(15)                       \
+  M(16) M(17) M(18) M(19) M(20) M(21) M(22) M(23)                     \
+  M(24) M(25) M(26) M(27) M(28) M(29) M(30) M(31)                     \
+  M(32) M(33) M(34) M(35) M(36) M(37) M(38) M(39)                     \
+  M(40) M(41) M(42) M(43) M(44) M(45) M(46) M(47)                     \
+  M(48) M(49) M(50) M(51) M(52) M(53) M(54) M(55)                     \
+  M(56) M(57) M(58) M(59) M(60) M(61) M(62) M(63)
+
+ALL (SHIFTS)
+
+const struct
+{
+  u64 (*shl) (u64);
+  u64 (*shr) (u64);
+  s64 (*sar) (s64);
+  u64 (*rol) (u64);
+} shifts[64] = { ALL (ENTRY) };
+
+enum { SHL, SHR, SAR, ROL };
+
+NI u64 ref_shift (int code, u64 x, int n)
+{
+  dword_t d;
+  d.x = x;
+
+  for (; n > 0; n--)
+    {
+      u32 lo = d.w[0], hi = d.w[1];
+
+      switch (code)
+        {
+        case SHL:
+          d.w[1] = (hi << 1) | (lo >> 31);
+          d.w[0] = lo << 1;
+          break;
+        case SHR:
+          d.w[1] = hi >> 1;
+          d.w[0] = (lo >> 1) | (hi << 31);
+          break;
+        case SAR:
+          d.w[1] = (u32) ((s32) hi >> 1);
+          d.w[0] = (lo >> 1) | (hi << 31);
+          break;
+        case ROL:
+          d.w[1] = (hi << 1) | (lo >> 31);
+          d.w[0] = (lo << 1) | (hi >> 31);
+          break;
+        }
+    }
+
+  return d.x;
+}
+
+const u64 values[] =
+  {
+    0, 1, 0x8000000000000000, 0x7fffffffffffffff, 0xffffffffffffffff,
+    0x0123456789abcdef, 0xfedcba9876543210, 0x8000000100008001
+  };
+
+int main (void)
+{
+  for (unsigned i = 0; i < sizeof (values) / sizeof (*values); i++)
+    for (int n = 0; n < 64; n++)
+      {
+        u64 x = values[i];
+
+        if (shifts[n].shl (x) != ref_shift (SHL, x, n)
+            || shifts[n].shr (x) != ref_shift (SHR, x, n)
+            || (u64) shifts[n].sar ((s64) x) != ref_shift (SAR, x, n)
+            || shifts[n].rol (x) != ref_shift (ROL, x, n))
+          __builtin_abort ();
+      }
+
+  return 0;
+}
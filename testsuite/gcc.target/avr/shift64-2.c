@@ -0,0 +1,7 @@
+/* { dg-do run } */
+/* { dg-options "-Os" } */
+
+/* With -Os, only the short shifts are inline and the others call
+   __<code>di3.  */
+
+#include "shift64-1.c"
@@ -0,0 +1,26 @@
+/* { dg-do compile } */
+/* { dg-options "-Os -fdump-rtl-mach" } */
+
+/* Both arms are QImode moves to the same register, hence the branch is
+   replaced by a move that is skipped by SBRC / SBRS.  */
+
+typedef __UINT8_TYPE__ uint8_t;
+
+uint8_t v;
+
+void test (uint8_t x, uint8_t a, uint8_t b)
+{
+  uint8_t r;
+
+  if (x & 4)
+    r = a;
+  else
+    r = b;
+
+  v = r;
+}
+
+/* { dg-final { scan-rtl-dump "if-converted jump insn" "mach" } } */
+/* { dg-final { scan-assembler "\tsbr\[cs\] r24,2" } } */
+/* { dg-final { scan-assembler-not "\trjmp" } } */
+/* { dg-final { cleanup-rtl-dump "mach" } } */
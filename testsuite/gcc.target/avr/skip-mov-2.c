@@ -0,0 +1,84 @@
+/* { dg-do run } */
+/* { dg-options "-Os" } */
+
+typedef __UINT8_TYPE__ uint8_t;
+
+volatile uint8_t v;
+
+__attribute__((noinline, noclone))
+void bit (uint8_t x, uint8_t a, uint8_t b)
+{
+  uint8_t r;
+
+  if (x & 4)
+    r = a;
+  else
+    r = b;
+
+  v = r;
+}
+
+__attribute__((noinline, noclone))
+void nbit (uint8_t x, uint8_t a, uint8_t b)
+{
+  uint8_t r;
+
+  if (!(x & 0x80))
+    r = a;
+  else
+    r = b;
+
+  v = r;
+}
+
+__attribute__((noinline, noclone))
+void equal (uint8_t x, uint8_t y, uint8_t a, uint8_t b)
+{
+  uint8_t r;
+
+  if (x == y)
+    r = a;
+  else
+    r = b;
+
+  v = r;
+}
+
+__attribute__((noinline, noclone))
+void constants (uint8_t x)
+{
+  uint8_t r;
+
+  if (x & 1)
+    r = 10;
+  else
+    r = 20;
+
+  v = r;
+}
+
+int main (void)
+{
+  for (unsigned i = 0; i < 256; i++)
+    {
+      uint8_t x = i;
+
+      bit (x, 1, 2);
+      if (v != ((x & 4) ? 1 : 2))
+        __builtin_abort ();
+
+      nbit (x, 3, 4);
+      if (v != ((x & 0x80) ? 4 : 3))
+        __builtin_abort ();
+
+      equal (x, 0x55, 5, 6);
+      if (v != (x == 0x55 ? 5 : 6))
+        __builtin_abort ();
+
+      constants (x);
+      if (v != ((x & 1) ? 10 : 20))
+        __builtin_abort ();
+    }
+
+  return 0;
+}
@@ -0,0 +1,12 @@
+/* { dg-do compile } */
+/* { dg-options "-Os -mvector-slot-isrs" } */
+
+/* The ISR saves nothing and consists of RETI only, hence it fits into
+   its vector slot.  */
+
+__attribute__((signal))
+void __vector_3 (void)
+{
+}
+
+/* { dg-final { scan-assembler "\\.section\\t\\.vectors\\.3," } } */
@@ -0,0 +1,20 @@
+/* { dg-do compile } */
+/* { dg-options "-Os" } */
+
+typedef __UINT32_TYPE__ uint32_t;
+
+extern volatile uint32_t count;
+
+__attribute__((vector_slot))
+void func (void) /* { dg-warning "only applies to" } */
+{
+  count = 0;
+}
+
+__attribute__((signal, vector_slot))
+void __vector_4 (void) /* { dg-warning "exceeds the vector slot" } */
+{
+  count++;
+}
+
+/* { dg-final { scan-assembler-not "\\.vectors\\.4" } } */
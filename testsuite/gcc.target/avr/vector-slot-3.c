@@ -0,0 +1,15 @@
+/* { dg-do run } */
+/* { dg-options "-Os -mvector-slot-isrs" } */
+
+/* Call an ISR that lives in its vector slot section.  */
+
+__attribute__((signal))
+void __vector_3 (void)
+{
+}
+
+int main (void)
+{
+  __vector_3 ();
+  return 0;
+}